@@ -0,0 +1,63 @@
+#!/bin/sh
+
+# Run the Criterion benches of the core crate and the TUI, collecting the
+# median and mean ns/iteration of each in $CRITERION_OUT (CSV). If
+# $CRITERION_BASELINE is set, fail when the median of any benchmark
+# regressed by more than $CRITERION_THRESHOLD percent against it, or when
+# there's no baseline there to compare against.
+#
+# Run from the repository's root, e.g. with `make bench_cli`.
+
+CRITERION_OUT=${CRITERION_OUT:-bench/criterion/latest.csv}
+CRITERION_THRESHOLD=${CRITERION_THRESHOLD:-10}
+TARGET_DIR=${CARGO_TARGET_DIR:-target}
+
+if [ -n "$CRITERION_BASELINE" ] && [ ! -f "$CRITERION_BASELINE" ]; then
+  echo "no baseline at $CRITERION_BASELINE, take one with \`make bench_cli_baseline\`" >&2
+  exit 1
+fi
+
+# Only collect what this run measured, not what's left from older benches
+stamp=$(mktemp)
+trap 'rm -f "$stamp"' EXIT
+
+cargo bench -p maccel-core --bench core -- --noplot $CRITERION_FILTER || exit 1
+cargo bench -p maccel-tui --features bench --bench frame -- --noplot $CRITERION_FILTER ||
+  exit 1
+
+mkdir -p "$(dirname "$CRITERION_OUT")"
+echo "name,ns_p50,ns_mean" >"$CRITERION_OUT"
+
+find "$TARGET_DIR/criterion" -path '*/new/estimates.json' -newer "$stamp" | sort |
+  while read -r estimates; do
+    name=$(sed 's/.*"full_id":"\([^"]*\)".*/\1/' "$(dirname "$estimates")/benchmark.json")
+    p50=$(sed 's/.*"median":{"confidence_interval":{[^}]*},"point_estimate":\([^,]*\).*/\1/' "$estimates")
+    mean=$(sed 's/.*"mean":{"confidence_interval":{[^}]*},"point_estimate":\([^,]*\).*/\1/' "$estimates")
+    echo "$name,$p50,$mean"
+  done >>"$CRITERION_OUT"
+
+echo "results written to $CRITERION_OUT"
+
+if [ -z "$CRITERION_BASELINE" ]; then
+  exit 0
+fi
+
+echo "comparing against $CRITERION_BASELINE (threshold: ${CRITERION_THRESHOLD}%)"
+
+awk -F, -v threshold="$CRITERION_THRESHOLD" '
+  FNR == 1 { next }
+  NR == FNR { baseline[$1] = $2; next }
+  {
+    if (!($1 in baseline)) next
+    change = ($2 - baseline[$1]) / baseline[$1] * 100
+    status = change > threshold ? "REGRESSION" : "ok"
+    if (change > threshold) failed++
+    printf "  %-10s %-48s %12.1fns -> %12.1fns (%+.1f%%)\n", status, $1, baseline[$1], $2, change
+  }
+  END {
+    if (failed) {
+      printf "%d benchmark(s) regressed by more than %s%%\n", failed, threshold
+      exit 1
+    }
+  }
+' "$CRITERION_BASELINE" "$CRITERION_OUT"
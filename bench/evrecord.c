@@ -0,0 +1,109 @@
+#include "trace.h"
+#include <errno.h>
+#include <linux/input.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Record the motion of a mouse into a trace file (see trace.h).
+ *
+ * Usage: evrecord /dev/input/eventN out.trace [seconds]
+ *
+ * NOTE: maccel modifies the events before evdev sees them, so record with the
+ * module unloaded (or in no_accel mode with SENS_MULT=1) to get raw frames.
+ * Stop the recording with Ctrl-C.
+ */
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig) {
+  (void)sig;
+  stop = 1;
+}
+
+static uint64_t to_ns(struct timeval time) {
+  return time.tv_sec * 1000000000ull + time.tv_usec * 1000ull;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s /dev/input/eventN out.trace [seconds]\n",
+            argv[0]);
+    return 1;
+  }
+
+  int fd = open(argv[1], O_RDONLY);
+  if (fd < 0) {
+    perror("Failed to open device");
+    return 1;
+  }
+
+  int clock = CLOCK_MONOTONIC;
+  if (ioctl(fd, EVIOCSCLOCKID, &clock) < 0) {
+    perror("Failed to set the event clock to CLOCK_MONOTONIC");
+    return 1;
+  }
+
+  char device_name[64] = "unknown";
+  ioctl(fd, EVIOCGNAME(sizeof(device_name)), device_name);
+
+  FILE *out = fopen(argv[2], "w");
+  if (out == NULL) {
+    perror("Failed to create the trace file");
+    return 1;
+  }
+
+  struct trace_header header = trace_header_new(device_name);
+  fwrite(&header, sizeof(header), 1, out);
+
+  struct sigaction action = {.sa_handler = on_signal};
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  if (argc > 3) {
+    sigaction(SIGALRM, &action, NULL);
+    alarm(atoi(argv[3]));
+  }
+
+  fprintf(stderr, "recording '%s' into %s, stop with Ctrl-C\n", device_name,
+          argv[2]);
+
+  struct trace_frame frame = {0};
+  struct input_event ev;
+  while (!stop) {
+    ssize_t n = read(fd, &ev, sizeof(ev));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n != sizeof(ev)) {
+      perror("Failed to read an event");
+      break;
+    }
+
+    if (ev.type == EV_REL && ev.code == REL_X) {
+      frame.x += ev.value;
+    } else if (ev.type == EV_REL && ev.code == REL_Y) {
+      frame.y += ev.value;
+    } else if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+      if (frame.x || frame.y) {
+        frame.time_ns = to_ns(ev.time);
+        fwrite(&frame, sizeof(frame), 1, out);
+        header.frame_count++;
+      }
+      frame = (struct trace_frame){0};
+    }
+  }
+
+  // Now that we know how many frames there are
+  fseek(out, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, out);
+  fclose(out);
+  close(fd);
+
+  fprintf(stderr, "recorded %lu frames\n", header.frame_count);
+
+  return 0;
+}
@@ -0,0 +1,284 @@
+#include "../driver/accel.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Replay a motion trace (see trace.h) through the driver's `f_accelerate`,
+ * as fast as possible, and report the throughput and a hash of the output.
+ *
+ * Usage: evreplay in.trace [-n passes] [-o out.trace] [--sysfs] [NAME=value...]
+ *
+ * Parameters are named like the module's parameters, with float values,
+ * e.g. `MODE=linear ACCEL=0.3 OFFSET=2`. They default to the module's
+ * defaults, or to its current values with `--sysfs`.
+ */
+
+#define SYSFS_PARAMS "/sys/module/maccel/parameters/"
+
+#if FIXEDPT_BITS == 64
+#define UNITS_PER_MS 1000000 // nanoseconds
+#else
+#define UNITS_PER_MS 1000 // microseconds
+#endif
+
+static const char *MODE_NAMES[] = {"linear", "natural", "synchronous",
+                                   "no_accel"};
+
+/* The module's default parameters (see params.h) */
+static struct accel_args default_args(enum accel_mode mode) {
+  struct accel_args args = {
+      .sens_mult = FIXEDPT_ONE,
+      .yx_ratio = FIXEDPT_ONE,
+      .input_dpi = fpt_fromint(1000),
+      .tag = mode,
+  };
+
+  switch (mode) {
+  case natural:
+    args.args.natural.decay_rate = fpt_rconst(0.1);
+    args.args.natural.limit = fpt_rconst(1.5);
+    break;
+  case synchronous:
+    args.args.synchronous.gamma = FIXEDPT_ONE;
+    args.args.synchronous.smooth = fpt_rconst(0.5);
+    args.args.synchronous.motivity = fpt_rconst(1.5);
+    args.args.synchronous.sync_speed = fpt_rconst(5);
+    break;
+  default:
+    break;
+  }
+  return args;
+}
+
+/* Where each named parameter goes in `struct accel_args`, for a given mode */
+static fpt *param_slot(struct accel_args *args, const char *name) {
+  if (!strcmp(name, "SENS_MULT"))
+    return &args->sens_mult;
+  if (!strcmp(name, "YX_RATIO"))
+    return &args->yx_ratio;
+  if (!strcmp(name, "INPUT_DPI"))
+    return &args->input_dpi;
+  if (!strcmp(name, "ANGLE_ROTATION"))
+    return &args->angle_rotation_deg;
+
+  switch (args->tag) {
+  case linear:
+    if (!strcmp(name, "ACCEL"))
+      return &args->args.linear.accel;
+    if (!strcmp(name, "OFFSET"))
+      return &args->args.linear.offset;
+    if (!strcmp(name, "OUTPUT_CAP"))
+      return &args->args.linear.output_cap;
+    break;
+  case natural:
+    if (!strcmp(name, "DECAY_RATE"))
+      return &args->args.natural.decay_rate;
+    if (!strcmp(name, "OFFSET"))
+      return &args->args.natural.offset;
+    if (!strcmp(name, "LIMIT"))
+      return &args->args.natural.limit;
+    break;
+  case synchronous:
+    if (!strcmp(name, "GAMMA"))
+      return &args->args.synchronous.gamma;
+    if (!strcmp(name, "SMOOTH"))
+      return &args->args.synchronous.smooth;
+    if (!strcmp(name, "MOTIVITY"))
+      return &args->args.synchronous.motivity;
+    if (!strcmp(name, "SYNC_SPEED"))
+      return &args->args.synchronous.sync_speed;
+    break;
+  default:
+    break;
+  }
+  return NULL;
+}
+
+static const char *MODE_PARAMS[][4] = {
+    {"ACCEL", "OFFSET", "OUTPUT_CAP", NULL},
+    {"DECAY_RATE", "OFFSET", "LIMIT", NULL},
+    {"GAMMA", "SMOOTH", "MOTIVITY", "SYNC_SPEED"},
+    {NULL},
+};
+
+static const char *COMMON_PARAMS[] = {"SENS_MULT", "YX_RATIO", "INPUT_DPI",
+                                      "ANGLE_ROTATION"};
+
+static int read_sysfs_param(const char *name, char *buf, size_t size) {
+  char path[128];
+  snprintf(path, sizeof(path), SYSFS_PARAMS "%s", name);
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    perror(path);
+    return -1;
+  }
+  int ok = fgets(buf, size, f) != NULL;
+  fclose(f);
+  return ok ? 0 : -1;
+}
+
+static int load_sysfs_args(struct accel_args *args) {
+  char value[64];
+  if (read_sysfs_param("MODE", value, sizeof(value)) < 0)
+    return -1;
+  args->tag = atoi(value);
+
+  for (size_t i = 0; i < 4; i++) {
+    if (read_sysfs_param(COMMON_PARAMS[i], value, sizeof(value)) < 0)
+      return -1;
+    *param_slot(args, COMMON_PARAMS[i]) = atofp(value);
+  }
+
+  for (size_t i = 0; args->tag <= no_accel && i < 4; i++) {
+    const char *name = MODE_PARAMS[args->tag][i];
+    if (name == NULL)
+      break;
+    if (read_sysfs_param(name, value, sizeof(value)) < 0)
+      return -1;
+    *param_slot(args, name) = atofp(value);
+  }
+  return 0;
+}
+
+static int parse_mode(const char *value) {
+  for (int mode = linear; mode <= no_accel; mode++) {
+    if (!strcmp(value, MODE_NAMES[mode]))
+      return mode;
+  }
+  return atoi(value);
+}
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len) {
+  const unsigned char *bytes = data;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+static uint64_t now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+  return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr,
+            "usage: %s in.trace [-n passes] [-o out.trace] [--sysfs] "
+            "[NAME=value...]\n",
+            argv[0]);
+    return 1;
+  }
+
+  int passes = 1;
+  const char *out_path = NULL;
+  struct accel_args args = default_args(linear);
+
+  /* The mode decides where the other parameters go, so it's handled first */
+  for (int i = 2; i < argc; i++) {
+    if (!strncmp(argv[i], "MODE=", 5)) {
+      args = default_args(parse_mode(argv[i] + 5));
+    }
+  }
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--sysfs") && load_sysfs_args(&args) < 0) {
+      return 1;
+    }
+  }
+
+  for (int i = 2; i < argc; i++) {
+    char *eq = strchr(argv[i], '=');
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+      passes = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if (eq != NULL && strncmp(argv[i], "MODE=", 5)) {
+      *eq = '\0';
+      fpt *slot = param_slot(&args, argv[i]);
+      if (slot == NULL) {
+        fprintf(stderr, "unknown parameter for the %s mode: %s\n",
+                MODE_NAMES[args.tag % 4], argv[i]);
+        return 1;
+      }
+      *slot = fpt_rconst(atof(eq + 1));
+    }
+  }
+
+  struct trace trace;
+  if (trace_map(argv[1], &trace) < 0) {
+    return 1;
+  }
+
+  if (trace.frame_count == 0) {
+    fprintf(stderr, "%s: the trace has no frames\n", argv[1]);
+    return 1;
+  }
+
+  FILE *out = NULL;
+  struct trace_header out_header;
+  if (out_path != NULL) {
+    out = fopen(out_path, "w");
+    if (out == NULL) {
+      perror("Failed to create the output trace file");
+      return 1;
+    }
+    out_header = trace_header_new(trace.header->device_name);
+    out_header.frame_count = trace.frame_count;
+    fwrite(&out_header, sizeof(out_header), 1, out);
+  }
+
+  uint64_t hash = 0xcbf29ce484222325ull;
+  uint64_t begin = now_ns();
+
+  for (int pass = 0; pass < passes; pass++) {
+    // Assume a 1000Hz polling rate for the very first frame
+    uint64_t last_time = trace.frames[0].time_ns - 1000000;
+
+    for (uint64_t i = 0; i < trace.frame_count; i++) {
+      const struct trace_frame *frame = &trace.frames[i];
+
+      // Same conversion of the interval as `accelerate()` in accel_k.h
+      int64_t unit_time =
+          (frame->time_ns - last_time) / (1000000 / UNITS_PER_MS);
+      last_time = frame->time_ns;
+      fpt millisecond = frame_interval_ms(unit_time, UNITS_PER_MS);
+
+      int x = frame->x;
+      int y = frame->y;
+      f_accelerate(&x, &y, millisecond, args);
+
+      if (pass == 0) {
+        int32_t xy[2] = {x, y};
+        hash = fnv1a(hash, xy, sizeof(xy));
+
+        if (out != NULL) {
+          struct trace_frame accelerated = {frame->time_ns, x, y};
+          fwrite(&accelerated, sizeof(accelerated), 1, out);
+        }
+      }
+    }
+  }
+
+  double elapsed = (now_ns() - begin) / 1e9;
+  uint64_t frames = trace.frame_count * passes;
+
+  printf("trace:      %s (%s)\n", argv[1], trace.header->device_name);
+  printf("mode:       %s, FIXEDPT_BITS=%d\n", MODE_NAMES[args.tag % 4],
+         FIXEDPT_BITS);
+  printf("frames:     %lu x %d passes\n", trace.frame_count, passes);
+  printf("throughput: %.0f frames/s (%.1fns/frame)\n", frames / elapsed,
+         elapsed * 1e9 / frames);
+  printf("hash:       %016lx\n", hash);
+
+  if (out != NULL) {
+    fclose(out);
+  }
+  trace_unmap(&trace);
+
+  return 0;
+}
@@ -0,0 +1,59 @@
+#!/bin/sh
+
+# Compare the latency that the two ways of accelerating add to the reports
+# of a (uhid) HID mouse, at several polling rates, by running bin/uhidlag:
+# with the module loaded (input_handler), with the HID-BPF program attached
+# instead (see hid_bpf/), and with neither (control).
+# Needs root (for uhid, modprobe and BPF), and leaves the module loaded again.
+#
+# Results go to results/hid/<rate>hz/{input_handler,hid_bpf,control}.csv,
+# and the p50/p99/max of every run to results/hid/summary.csv.
+#
+# Usage: hid_latency.sh [rate_hz...]
+
+RATES=${*:-125 500 1000 2000 4000 8000}
+FRAMES=${FRAMES:-1000}
+HID_BPF=${HID_BPF:-../hid_bpf/maccel-hid-bpf}
+
+if [ "$(id -u)" -ne 0 ]; then
+  echo "run as root: uhid, BPF and (un)loading maccel need it" >&2
+  exit 1
+fi
+
+if [ ! -x "$HID_BPF" ]; then
+  echo "$HID_BPF not found, build it with \`make -C ../hid_bpf\`" >&2
+  exit 1
+fi
+
+if ! modprobe maccel; then
+  echo "failed to load maccel, is it installed?" >&2
+  exit 1
+fi
+
+trap 'modprobe maccel' EXIT INT TERM
+
+mkdir -p results/hid
+rm -f results/hid/summary.csv
+
+for rate in $RATES; do
+  dir=results/hid/${rate}hz
+  mkdir -p "$dir"
+
+  bin/uhidlag -r "$rate" -n "$FRAMES" -o "$dir/input_handler.csv" \
+    -s results/hid/summary.csv -l maccel || exit 1
+
+  modprobe -r maccel || exit 1
+  bin/uhidlag -r "$rate" -n "$FRAMES" -o "$dir/control.csv" \
+    -s results/hid/summary.csv -l control || exit 1
+
+  "$HID_BPF" 2>"$dir/hid_bpf.log" &
+  loader=$!
+  bin/uhidlag -r "$rate" -n "$FRAMES" -o "$dir/hid_bpf.csv" \
+    -s results/hid/summary.csv -l hid_bpf
+  status=$?
+  kill "$loader"
+  wait "$loader" 2>/dev/null
+  [ "$status" -eq 0 ] || exit 1
+
+  modprobe maccel || exit 1
+done
@@ -0,0 +1,59 @@
+#!/bin/sh
+
+# Measure the latency that maccel adds to mouse frames, at several polling
+# rates, by running bin/uinputlag with the module loaded and then unloaded.
+# Needs root (for uinput and modprobe), and leaves the module loaded again.
+#
+# While the module is unloaded, the userspace engine (`$MACCEL engine`, if
+# that's found) gets measured too, reading its parameters from the same
+# store as the CLI does: /var/opt/maccel/parameters.
+#
+# Results go to results/<rate>hz/{input_handler,control,engine}.csv, which
+# `python plot.py results/<rate>hz` can plot, and the p50/p99/max of every
+# run to results/summary.csv.
+#
+# Usage: latency.sh [rate_hz...]
+
+RATES=${*:-125 500 1000 2000 4000 8000}
+FRAMES=${FRAMES:-1000}
+MACCEL=${MACCEL:-$(command -v maccel)}
+
+if [ "$(id -u)" -ne 0 ]; then
+  echo "run as root: uinput and (un)loading maccel need it" >&2
+  exit 1
+fi
+
+if ! modprobe maccel; then
+  echo "failed to load maccel, is it installed?" >&2
+  exit 1
+fi
+
+# Put the module back even if we get interrupted
+trap 'modprobe maccel' EXIT INT TERM
+
+mkdir -p results
+rm -f results/summary.csv
+
+for rate in $RATES; do
+  dir=results/${rate}hz
+  mkdir -p "$dir"
+
+  bin/uinputlag -r "$rate" -n "$FRAMES" -o "$dir/input_handler.csv" \
+    -s results/summary.csv -l maccel || exit 1
+
+  modprobe -r maccel || exit 1
+  bin/uinputlag -r "$rate" -n "$FRAMES" -o "$dir/control.csv" \
+    -s results/summary.csv -l control || exit 1
+
+  if [ -n "$MACCEL" ]; then
+    "$MACCEL" engine 2>"$dir/engine.log" &
+    engine=$!
+    bin/uinputlag -r "$rate" -n "$FRAMES" -o "$dir/engine.csv" \
+      -s results/summary.csv -l engine -t engine
+    status=$?
+    kill "$engine"
+    wait "$engine" 2>/dev/null
+    [ "$status" -eq 0 ] || exit 1
+  fi
+  modprobe maccel || exit 1
+done
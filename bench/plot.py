@@ -1,16 +1,21 @@
+import sys
+
 import matplotlib.pyplot as plt
 import numpy as np
 import pandas as pd
 
-control_data = pd.read_csv("control.csv")
-new_data = pd.read_csv("input_handler.csv")
+# A directory with control.csv & input_handler.csv, e.g. from latency.sh
+results_dir = sys.argv[1] if len(sys.argv) > 1 else "."
+
+control_data = pd.read_csv(f"{results_dir}/control.csv")
+new_data = pd.read_csv(f"{results_dir}/input_handler.csv")
 
 fig, ax = plt.subplots()
 
-ax.plot(np.arange(1000), control_data["diff"], 'b',
+ax.plot(np.arange(len(control_data)), control_data["diff"], 'b',
         label=f"Hid-generic (mean = {control_data["diff"].mean()}us)")
 
-ax.plot(np.arange(1000), new_data["diff"], 'g',
+ax.plot(np.arange(len(new_data)), new_data["diff"], 'g',
         label=f"New driver  (mean = {new_data["diff"].mean()}us)")
 
 plt.ylabel('lag (us)')
@@ -20,13 +25,10 @@ legend = ax.legend(loc='upper center', fontsize='x-large')
 
 plt.show()
 
-""" Some extra data points out of curiosity """
-
-virtual_minus_source = new_data["virtual_event_time"] - new_data["event_time"]
-print("average lag between source and virtual device:",
-      virtual_minus_source.mean())
+""" The latency distribution added by the driver """
 
-new_data["read_minus_virtual"] = new_data["read_time"] - \
-    new_data["virtual_event_time"]
-print("average lag between virtual device and read:",
-      new_data["read_minus_virtual"].mean())
+for q in [0.5, 0.99, 1.0]:
+    control_q = control_data["diff"].quantile(q)
+    new_q = new_data["diff"].quantile(q)
+    print(f"p{q * 100:g}: {control_q:.1f}us -> {new_q:.1f}us "
+          f"({new_q - control_q:+.1f}us)")
@@ -0,0 +1,54 @@
+#!/bin/sh
+
+# Run bin/uinputstress with maccel loaded and then unloaded. With the module
+# loaded it is put in no_accel mode with a fractional SENS_MULT, so that the
+# output of each device only depends on its own input (and carry), and any
+# difference from its single-device reference is cross-talk. The parameters
+# are restored afterwards. Needs root, and leaves the module loaded again.
+#
+# Results go to results/stress_{maccel,control}.csv; the difference in
+# sys_per_frame (us) between the two is the CPU time spent in the handler.
+#
+# Usage: stress.sh [devices] [rate_hz]
+
+DEVICES=${1:-$(nproc)}
+RATE=${2:-8000}
+FRAMES=${FRAMES:-8000}
+PARAMS=/sys/module/maccel/parameters
+
+if [ "$(id -u)" -ne 0 ]; then
+  echo "run as root: uinput and (un)loading maccel need it" >&2
+  exit 1
+fi
+
+if ! modprobe maccel; then
+  echo "failed to load maccel, is it installed?" >&2
+  exit 1
+fi
+
+MODE=$(cat $PARAMS/MODE)
+SENS_MULT=$(cat $PARAMS/SENS_MULT)
+
+restore() {
+  modprobe maccel
+  echo "$MODE" >$PARAMS/MODE
+  echo "$SENS_MULT" >$PARAMS/SENS_MULT
+}
+trap restore EXIT INT TERM
+
+# 0.75, in the module's fixed-point format
+if [ "$(getconf LONG_BIT)" = 64 ]; then
+  echo 3221225472 >$PARAMS/SENS_MULT
+else
+  echo 49152 >$PARAMS/SENS_MULT
+fi
+echo 3 >$PARAMS/MODE # no_accel
+
+mkdir -p results
+
+bin/uinputstress -d "$DEVICES" -r "$RATE" -n "$FRAMES" \
+  -o results/stress_maccel.csv || exit 1
+
+modprobe -r maccel || exit 1
+bin/uinputstress -d "$DEVICES" -r "$RATE" -n "$FRAMES" \
+  -o results/stress_control.csv || exit 1
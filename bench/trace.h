@@ -0,0 +1,111 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Motion trace: the raw (x, y) frames of a mouse, each stamped with the
+ * monotonic time (ns) of its SYN_REPORT.
+ *
+ * The file is a `struct trace_header` followed by `frame_count` fixed-size
+ * `struct trace_frame`s, all in native (little) endian, so that it can be
+ * mmap'd and indexed directly.
+ */
+
+#define TRACE_MAGIC "MACLTRC1"
+#define TRACE_VERSION 1
+
+struct trace_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t frame_size;
+  uint32_t _reserved;
+  uint64_t frame_count;
+  char device_name[64];
+};
+
+struct trace_frame {
+  uint64_t time_ns;
+  int32_t x;
+  int32_t y;
+};
+
+_Static_assert(sizeof(struct trace_header) == 96, "trace header layout");
+_Static_assert(sizeof(struct trace_frame) == 16, "trace frame layout");
+
+static inline struct trace_header trace_header_new(const char *device_name) {
+  struct trace_header header = {
+      .version = TRACE_VERSION,
+      .header_size = sizeof(struct trace_header),
+      .frame_size = sizeof(struct trace_frame),
+  };
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  snprintf(header.device_name, sizeof(header.device_name), "%s", device_name);
+  return header;
+}
+
+struct trace {
+  const struct trace_header *header;
+  const struct trace_frame *frames;
+  uint64_t frame_count;
+  size_t map_size;
+};
+
+/* Map a trace file, returns -1 (with a message on stderr) if it's invalid */
+static inline int trace_map(const char *path, struct trace *trace) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror("failed to open the trace file");
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct trace_header)) {
+    fprintf(stderr, "%s: not a motion trace (too small)\n", path);
+    close(fd);
+    return -1;
+  }
+
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror("failed to mmap the trace file");
+    return -1;
+  }
+
+  const struct trace_header *header = map;
+  if (memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != TRACE_VERSION ||
+      header->frame_size != sizeof(struct trace_frame)) {
+    fprintf(stderr, "%s: not a motion trace (v%d)\n", path, TRACE_VERSION);
+    munmap(map, st.st_size);
+    return -1;
+  }
+
+  uint64_t available =
+      (st.st_size - header->header_size) / sizeof(struct trace_frame);
+
+  trace->header = header;
+  trace->frames =
+      (const struct trace_frame *)((const char *)map + header->header_size);
+  /* a recording that was cut short has frames past its frame_count */
+  trace->frame_count = header->frame_count ? header->frame_count : available;
+  if (trace->frame_count > available) {
+    trace->frame_count = available;
+  }
+  trace->map_size = st.st_size;
+  return 0;
+}
+
+static inline void trace_unmap(struct trace *trace) {
+  munmap((void *)trace->header, trace->map_size);
+}
+
+#endif // !_TRACE_H_
@@ -0,0 +1,230 @@
+#include "virtual_mouse.h"
+#include <linux/uhid.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Like uinputlag, but the virtual mouse is a HID device (through uhid), so
+ * that its reports go through the HID core: where the HID-BPF program
+ * (hid_bpf/) rewrites them, before the input core and its input_handlers
+ * (the maccel module included) see the events.
+ *
+ * Run it with the module loaded, with maccel-hid-bpf running instead, and
+ * with neither (see hid_latency.sh), to compare the latency of the two paths.
+ *
+ * Usage: uhidlag [-r rate_hz] [-n frames] [-o out.csv]
+ *                [-s summary.csv -l label]
+ */
+
+/* A mouse with 3 buttons, and a 16 bits relative X and Y */
+static const unsigned char REPORT_DESCRIPTOR[] = {
+    0x05, 0x01,       // Usage Page (Generic Desktop)
+    0x09, 0x02,       // Usage (Mouse)
+    0xa1, 0x01,       // Collection (Application)
+    0x09, 0x01,       //   Usage (Pointer)
+    0xa1, 0x00,       //   Collection (Physical)
+    0x05, 0x09,       //     Usage Page (Button)
+    0x19, 0x01,       //     Usage Minimum (1)
+    0x29, 0x03,       //     Usage Maximum (3)
+    0x15, 0x00,       //     Logical Minimum (0)
+    0x25, 0x01,       //     Logical Maximum (1)
+    0x95, 0x03,       //     Report Count (3)
+    0x75, 0x01,       //     Report Size (1)
+    0x81, 0x02,       //     Input (Data, Variable, Absolute)
+    0x95, 0x01,       //     Report Count (1)
+    0x75, 0x05,       //     Report Size (5)
+    0x81, 0x01,       //     Input (Constant)
+    0x05, 0x01,       //     Usage Page (Generic Desktop)
+    0x09, 0x30,       //     Usage (X)
+    0x09, 0x31,       //     Usage (Y)
+    0x16, 0x01, 0x80, //     Logical Minimum (-32767)
+    0x26, 0xff, 0x7f, //     Logical Maximum (32767)
+    0x75, 0x10,       //     Report Size (16)
+    0x95, 0x02,       //     Report Count (2)
+    0x81, 0x06,       //     Input (Data, Variable, Relative)
+    0xc0,             //   End Collection
+    0xc0,             // End Collection
+};
+
+static int uhid_mouse_create(const char *name) {
+  int fd = open("/dev/uhid", O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    perror("Failed to open /dev/uhid");
+    return -1;
+  }
+
+  struct uhid_event ev = {.type = UHID_CREATE2};
+  strncpy((char *)ev.u.create2.name, name, sizeof(ev.u.create2.name) - 1);
+  memcpy(ev.u.create2.rd_data, REPORT_DESCRIPTOR, sizeof(REPORT_DESCRIPTOR));
+  ev.u.create2.rd_size = sizeof(REPORT_DESCRIPTOR);
+  ev.u.create2.bus = BUS_USB;
+  ev.u.create2.vendor = 0x6d61;
+  ev.u.create2.product = 0x6364;
+
+  if (write(fd, &ev, sizeof(ev)) != sizeof(ev)) {
+    perror("Failed to create the uhid mouse");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int uhid_mouse_move(int fd, int x, int y) {
+  struct uhid_event ev = {.type = UHID_INPUT2};
+  unsigned char *report = ev.u.input2.data;
+  report[0] = 0; // no buttons
+  report[1] = x & 0xff;
+  report[2] = (x >> 8) & 0xff;
+  report[3] = y & 0xff;
+  report[4] = (y >> 8) & 0xff;
+  ev.u.input2.size = 5;
+
+  if (write(fd, &ev, sizeof(ev)) != sizeof(ev)) {
+    perror("Failed to write a report to uhid");
+    return -1;
+  }
+  return 0;
+}
+
+static void uhid_mouse_destroy(int fd) {
+  struct uhid_event ev = {.type = UHID_DESTROY};
+  write(fd, &ev, sizeof(ev));
+  close(fd);
+}
+
+int main(int argc, char **argv) {
+  int rate = 1000;
+  int frames = 1000;
+  const char *out_path = NULL;
+  const char *summary_path = NULL;
+  const char *label = "";
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-r")) {
+      rate = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "-n")) {
+      frames = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "-o")) {
+      out_path = argv[i + 1];
+    } else if (!strcmp(argv[i], "-s")) {
+      summary_path = argv[i + 1];
+    } else if (!strcmp(argv[i], "-l")) {
+      label = argv[i + 1];
+    } else {
+      fprintf(stderr,
+              "usage: %s [-r rate_hz] [-n frames] [-o out.csv] "
+              "[-s summary.csv -l label]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if (rate <= 0 || rate > 8000 || frames <= 0) {
+    fprintf(stderr, "the rate must be in (0, 8000]Hz and frames > 0\n");
+    return 1;
+  }
+
+  FILE *out = out_path ? fopen(out_path, "w") : stdout;
+  if (out == NULL) {
+    perror("Failed to create the CSV file");
+    return 1;
+  }
+
+  const char *name = "maccel bench uhid mouse";
+  int uhid_fd = uhid_mouse_create(name);
+  if (uhid_fd < 0) {
+    return 1;
+  }
+
+  // Only the evdev side of `struct virtual_mouse` is used, to read frames
+  struct virtual_mouse mouse = {.uinput_fd = -1};
+  mouse.evdev_fd =
+      open_evdev_by_name(name, mouse.evdev_path, sizeof(mouse.evdev_path));
+  if (mouse.evdev_fd < 0) {
+    fprintf(stderr, "Failed to open the evdev node of %s\n", name);
+    return 1;
+  }
+
+  uint64_t *write_times = calloc(frames, sizeof(uint64_t));
+  uint64_t *latencies = calloc(frames, sizeof(uint64_t));
+  int received = 0;
+  int lost = 0;
+
+  // maccel-hid-bpf looks for new mice every 500ms
+  usleep(1000000);
+
+  uint64_t period_ns = 1000000000ull / rate;
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+  for (int i = 0; i < frames; i++) {
+    deadline.tv_nsec += period_ns;
+    while (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_nsec -= 1000000000;
+      deadline.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+
+    // Back and forth, so that the cursor doesn't run away
+    int d = i % 2 ? -3 : 3;
+
+    uint64_t write_time = now_ns();
+    if (uhid_mouse_move(uhid_fd, d, d) < 0) {
+      break;
+    }
+
+    int x, y;
+    if (virtual_mouse_read(&mouse, &x, &y, 100) < 0) {
+      lost++;
+      continue;
+    }
+    uint64_t read_time = now_ns();
+
+    write_times[received] = write_time;
+    latencies[received] = read_time - write_time;
+    received++;
+  }
+
+  fprintf(out, "event_time,read_time,diff\n"); // eve'ry is in us
+  for (int i = 0; i < received; i++) {
+    fprintf(out, "%.3f,%.3f,%.3f\n", write_times[i] / 1e3,
+            (write_times[i] + latencies[i]) / 1e3, latencies[i] / 1e3);
+  }
+
+  qsort(latencies, received, sizeof(uint64_t), cmp_u64);
+  if (received == 0) {
+    fprintf(stderr, "%dHz: all %d frames were lost\n", rate, lost);
+  } else {
+    double p50 = latencies[received / 2] / 1e3;
+    double p99 = latencies[(received - 1) * 99 / 100] / 1e3;
+    double max = latencies[received - 1] / 1e3;
+
+    fprintf(stderr,
+            "%dHz %s: %d frames (%d lost), latency p50 = %.1fus, "
+            "p99 = %.1fus, max = %.1fus\n",
+            rate, label, received, lost, p50, p99, max);
+
+    FILE *summary = summary_path ? fopen(summary_path, "a") : NULL;
+    if (summary != NULL) {
+      fseek(summary, 0, SEEK_END);
+      if (ftell(summary) == 0) {
+        fprintf(summary, "rate_hz,label,frames,lost,p50,p99,max\n");
+      }
+      fprintf(summary, "%d,%s,%d,%d,%.3f,%.3f,%.3f\n", rate, label, received,
+              lost, p50, p99, max);
+      fclose(summary);
+    }
+  }
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  close(mouse.evdev_fd);
+  uhid_mouse_destroy(uhid_fd);
+  free(write_times);
+  free(latencies);
+
+  return received > 0 ? 0 : 1;
+}
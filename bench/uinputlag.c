@@ -0,0 +1,162 @@
+#include "virtual_mouse.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Measure the latency of mouse frames from the moment they're injected
+ * through a uinput virtual mouse, to the moment they're read back from its
+ * evdev node; i.e. including every input_handler that ran on the frames.
+ * Run it with and without maccel loaded (see latency.sh) to get the latency
+ * added by the module.
+ *
+ * With `-t engine`, the frames are read back from the clone of the virtual
+ * mouse that `maccel engine` creates, to get the latency of the userspace
+ * engine instead.
+ *
+ * Usage: uinputlag [-r rate_hz] [-n frames] [-o out.csv]
+ *                  [-s summary.csv -l label] [-t evdev|engine]
+ *
+ * The CSV has one row per frame with the write time, the read time and
+ * their difference, all in microseconds, as bench/plot.py expects.
+ * The latency distribution is appended as a row of the summary CSV.
+ */
+
+int main(int argc, char **argv) {
+  int rate = 1000;
+  int frames = 1000;
+  const char *out_path = NULL;
+  const char *summary_path = NULL;
+  const char *label = "";
+  const char *target = "evdev";
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-r")) {
+      rate = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "-n")) {
+      frames = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "-o")) {
+      out_path = argv[i + 1];
+    } else if (!strcmp(argv[i], "-s")) {
+      summary_path = argv[i + 1];
+    } else if (!strcmp(argv[i], "-l")) {
+      label = argv[i + 1];
+    } else if (!strcmp(argv[i], "-t")) {
+      target = argv[i + 1];
+    } else {
+      fprintf(stderr,
+              "usage: %s [-r rate_hz] [-n frames] [-o out.csv] "
+              "[-s summary.csv -l label] [-t evdev|engine]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if (rate <= 0 || rate > 8000 || frames <= 0) {
+    fprintf(stderr, "the rate must be in (0, 8000]Hz and frames > 0\n");
+    return 1;
+  }
+
+  if (strcmp(target, "evdev") && strcmp(target, "engine")) {
+    fprintf(stderr, "the target must be evdev or engine\n");
+    return 1;
+  }
+
+  FILE *out = out_path ? fopen(out_path, "w") : stdout;
+  if (out == NULL) {
+    perror("Failed to create the CSV file");
+    return 1;
+  }
+
+  const char *name = "maccel bench virtual mouse";
+  struct virtual_mouse mouse;
+  if (virtual_mouse_create(&mouse, name) < 0) {
+    return 1;
+  }
+
+  if (!strcmp(target, "engine") &&
+      virtual_mouse_follow_engine(&mouse, name) < 0) {
+    return 1;
+  }
+
+  uint64_t *write_times = calloc(frames, sizeof(uint64_t));
+  uint64_t *latencies = calloc(frames, sizeof(uint64_t));
+  int received = 0;
+  int lost = 0;
+
+  // Let the input handlers (and the rest of userspace) settle on the device
+  usleep(200000);
+
+  uint64_t period_ns = 1000000000ull / rate;
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+  for (int i = 0; i < frames; i++) {
+    deadline.tv_nsec += period_ns;
+    while (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_nsec -= 1000000000;
+      deadline.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+
+    // Back and forth, so that the cursor doesn't run away
+    int d = i % 2 ? -3 : 3;
+
+    uint64_t write_time = now_ns();
+    if (virtual_mouse_move(&mouse, d, d) < 0) {
+      break;
+    }
+
+    int x, y;
+    if (virtual_mouse_read(&mouse, &x, &y, 100) < 0) {
+      lost++;
+      continue;
+    }
+    uint64_t read_time = now_ns();
+
+    write_times[received] = write_time;
+    latencies[received] = read_time - write_time;
+    received++;
+  }
+
+  fprintf(out, "event_time,read_time,diff\n"); // eve'ry is in us
+  for (int i = 0; i < received; i++) {
+    fprintf(out, "%.3f,%.3f,%.3f\n", write_times[i] / 1e3,
+            (write_times[i] + latencies[i]) / 1e3, latencies[i] / 1e3);
+  }
+
+  qsort(latencies, received, sizeof(uint64_t), cmp_u64);
+  if (received == 0) {
+    fprintf(stderr, "%dHz: all %d frames were lost\n", rate, lost);
+  } else {
+    double p50 = latencies[received / 2] / 1e3;
+    double p99 = latencies[(received - 1) * 99 / 100] / 1e3;
+    double max = latencies[received - 1] / 1e3;
+
+    fprintf(stderr,
+            "%dHz %s: %d frames (%d lost), latency p50 = %.1fus, "
+            "p99 = %.1fus, max = %.1fus\n",
+            rate, label, received, lost, p50, p99, max);
+
+    FILE *summary = summary_path ? fopen(summary_path, "a") : NULL;
+    if (summary != NULL) {
+      fseek(summary, 0, SEEK_END);
+      if (ftell(summary) == 0) {
+        fprintf(summary, "rate_hz,label,frames,lost,p50,p99,max\n");
+      }
+      fprintf(summary, "%d,%s,%d,%d,%.3f,%.3f,%.3f\n", rate, label, received,
+              lost, p50, p99, max);
+      fclose(summary);
+    }
+  }
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  virtual_mouse_destroy(&mouse);
+  free(write_times);
+  free(latencies);
+
+  return received > 0 ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+#define _GNU_SOURCE
+#include "virtual_mouse.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+/**
+ * Drive many virtual mice at once, each from a thread pinned to its own CPU,
+ * to see how maccel behaves with concurrent devices.
+ *
+ * Every device first plays its (deterministic) input stream alone, to get a
+ * reference output, then all of them play their streams concurrently. We
+ * report the aggregate throughput, the latency distribution and system CPU
+ * time per frame of each device, and how many of its output frames differ
+ * from the reference: i.e. cross-talk between devices.
+ *
+ * NOTE: the output can only match the reference exactly if it doesn't depend
+ * on the timing of the frames, e.g. with MODE=no_accel and a fractional
+ * SENS_MULT, which exercises the carry. stress.sh sets that up.
+ *
+ * Usage: uinputstress [-d devices] [-r rate_hz] [-n frames] [-o out.csv]
+ */
+
+struct device_run {
+  int id;
+  int cpu;
+  int frames;
+  int rate;
+  struct virtual_mouse mouse;
+  pthread_barrier_t *start;
+
+  int (*input)[2];
+  int (*reference)[2];
+  int (*output)[2];
+  uint64_t *latencies;
+
+  int received;
+  int lost;
+  int mismatches;
+  uint64_t sys_time_ns;
+};
+
+/* Deterministic input stream of a device, from a small LCG seeded by its id */
+static void generate_input(struct device_run *run) {
+  uint32_t state = 0x2545F491u * (run->id + 1);
+  for (int i = 0; i < run->frames; i++) {
+    state = state * 1664525u + 1013904223u;
+    int x = (int)(state >> 28) - 8;
+    int y = (int)((state >> 24) & 0xF) - 8;
+    if (x == 0 && y == 0) {
+      x = 1;
+    }
+    // Back and forth, so that the cursor doesn't run away
+    run->input[i][0] = i % 2 ? -x : x;
+    run->input[i][1] = i % 2 ? -y : y;
+  }
+}
+
+static uint64_t thread_sys_time_ns(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return usage.ru_stime.tv_sec * 1000000000ull +
+         usage.ru_stime.tv_usec * 1000ull;
+}
+
+/* Play the device's input stream at its rate, collecting the output */
+static void play(struct device_run *run, int (*output)[2]) {
+  uint64_t period_ns = 1000000000ull / run->rate;
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+  run->received = 0;
+  run->lost = 0;
+  uint64_t sys_time_start = thread_sys_time_ns();
+
+  for (int i = 0; i < run->frames; i++) {
+    deadline.tv_nsec += period_ns;
+    while (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_nsec -= 1000000000;
+      deadline.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+
+    uint64_t write_time = now_ns();
+    if (virtual_mouse_move(&run->mouse, run->input[i][0], run->input[i][1]) <
+        0) {
+      break;
+    }
+
+    if (virtual_mouse_read(&run->mouse, &output[i][0], &output[i][1], 100) <
+        0) {
+      output[i][0] = output[i][1] = 0;
+      run->lost++;
+      continue;
+    }
+    run->latencies[run->received++] = now_ns() - write_time;
+  }
+
+  run->sys_time_ns = thread_sys_time_ns() - sys_time_start;
+}
+
+static void pin_to_cpu(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    fprintf(stderr, "failed to pin a device's thread to cpu %d\n", cpu);
+  }
+}
+
+static void *reference_thread(void *arg) {
+  struct device_run *run = arg;
+  pin_to_cpu(run->cpu);
+  play(run, run->reference);
+  return NULL;
+}
+
+static void *concurrent_thread(void *arg) {
+  struct device_run *run = arg;
+  pin_to_cpu(run->cpu);
+  pthread_barrier_wait(run->start);
+  play(run, run->output);
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int devices = cpus;
+  int rate = 8000;
+  int frames = 8000;
+  const char *out_path = NULL;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "-d")) {
+      devices = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "-r")) {
+      rate = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "-n")) {
+      frames = atoi(argv[i + 1]);
+    } else if (!strcmp(argv[i], "-o")) {
+      out_path = argv[i + 1];
+    } else {
+      fprintf(stderr,
+              "usage: %s [-d devices] [-r rate_hz] [-n frames] [-o out.csv]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  if (devices <= 0 || rate <= 0 || rate > 8000 || frames <= 0) {
+    fprintf(stderr, "devices > 0, the rate in (0, 8000]Hz and frames > 0\n");
+    return 1;
+  }
+
+  pthread_barrier_t start;
+  pthread_barrier_init(&start, NULL, devices);
+
+  struct device_run *runs = calloc(devices, sizeof(struct device_run));
+  pthread_t *threads = calloc(devices, sizeof(pthread_t));
+
+  for (int d = 0; d < devices; d++) {
+    struct device_run *run = &runs[d];
+    run->id = d;
+    run->cpu = d % cpus;
+    run->frames = frames;
+    run->rate = rate;
+    run->start = &start;
+    run->input = calloc(frames, sizeof(*run->input));
+    run->reference = calloc(frames, sizeof(*run->reference));
+    run->output = calloc(frames, sizeof(*run->output));
+    run->latencies = calloc(frames, sizeof(uint64_t));
+    generate_input(run);
+
+    char name[64];
+    snprintf(name, sizeof(name), "maccel stress virtual mouse %d", d);
+    if (virtual_mouse_create(&run->mouse, name) < 0) {
+      return 1;
+    }
+  }
+
+  // Let the input handlers (and the rest of userspace) settle on the devices
+  usleep(500000);
+
+  fprintf(stderr, "playing the reference of %d devices, one at a time\n",
+          devices);
+  for (int d = 0; d < devices; d++) {
+    pthread_create(&threads[d], NULL, reference_thread, &runs[d]);
+    pthread_join(threads[d], NULL);
+  }
+
+  fprintf(stderr, "playing %d devices concurrently at %dHz\n", devices, rate);
+  uint64_t begin = now_ns();
+  for (int d = 0; d < devices; d++) {
+    pthread_create(&threads[d], NULL, concurrent_thread, &runs[d]);
+  }
+  for (int d = 0; d < devices; d++) {
+    pthread_join(threads[d], NULL);
+  }
+  double elapsed = (now_ns() - begin) / 1e9;
+
+  FILE *out = out_path ? fopen(out_path, "w") : stdout;
+  if (out == NULL) {
+    perror("Failed to create the CSV file");
+    return 1;
+  }
+
+  fprintf(out, "device,cpu,frames,lost,mismatches,p50,p99,max,sys_per_frame\n");
+
+  long total_received = 0, total_mismatches = 0;
+  for (int d = 0; d < devices; d++) {
+    struct device_run *run = &runs[d];
+    for (int i = 0; i < frames; i++) {
+      if (run->output[i][0] != run->reference[i][0] ||
+          run->output[i][1] != run->reference[i][1]) {
+        run->mismatches++;
+      }
+    }
+
+    qsort(run->latencies, run->received, sizeof(uint64_t), cmp_u64);
+    int n = run->received;
+    fprintf(out, "%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f\n", d, run->cpu, n,
+            run->lost, run->mismatches,
+            n ? run->latencies[n / 2] / 1e3 : 0,
+            n ? run->latencies[(n - 1) * 99 / 100] / 1e3 : 0,
+            n ? run->latencies[n - 1] / 1e3 : 0,
+            n ? run->sys_time_ns / 1e3 / n : 0);
+
+    total_received += n;
+    total_mismatches += run->mismatches;
+    virtual_mouse_destroy(&run->mouse);
+  }
+
+  fprintf(stderr,
+          "%d devices: %.0f frames/s aggregate, %ld/%ld frames differ from "
+          "the single-device reference\n",
+          devices, total_received / elapsed, total_mismatches,
+          (long)devices * frames);
+
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  return 0;
+}
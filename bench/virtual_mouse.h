@@ -0,0 +1,244 @@
+#ifndef _VIRTUAL_MOUSE_H_
+#define _VIRTUAL_MOUSE_H_
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Helpers for the benchmarks that drive a virtual mouse through uinput and
+ * read its frames back from the evdev node that the input core creates
+ * for it, i.e. after every input_handler (maccel included) ran on them.
+ */
+
+struct virtual_mouse {
+  int uinput_fd;
+  int evdev_fd;
+  char evdev_path[64];
+};
+
+static inline uint64_t now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+/* Find /dev/input/eventN of the uinput device, given its sysname */
+static inline int find_evdev_node(const char *sysname, char *path,
+                                  size_t size) {
+  char sys_path[128];
+  snprintf(sys_path, sizeof(sys_path), "/sys/devices/virtual/input/%s",
+           sysname);
+
+  DIR *dir = opendir(sys_path);
+  if (dir == NULL) {
+    return -1;
+  }
+
+  int found = -1;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    // Skip a node whose path wouldn't fit, rather than open a truncated one
+    if (strncmp(entry->d_name, "event", 5) == 0 &&
+        snprintf(path, size, "/dev/input/%s", entry->d_name) < (int)size) {
+      found = 0;
+      break;
+    }
+  }
+  closedir(dir);
+  return found;
+}
+
+static inline int virtual_mouse_create(struct virtual_mouse *mouse,
+                                       const char *name) {
+  mouse->uinput_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+  if (mouse->uinput_fd < 0) {
+    perror("Failed to open /dev/uinput");
+    return -1;
+  }
+
+  int fd = mouse->uinput_fd;
+  ioctl(fd, UI_SET_EVBIT, EV_KEY);
+  ioctl(fd, UI_SET_KEYBIT, BTN_LEFT);
+  ioctl(fd, UI_SET_EVBIT, EV_REL);
+  ioctl(fd, UI_SET_RELBIT, REL_X);
+  ioctl(fd, UI_SET_RELBIT, REL_Y);
+
+  struct uinput_setup setup = {
+      .id = {.bustype = BUS_VIRTUAL, .vendor = 0x6d61, .product = 0x6363},
+  };
+  strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1);
+
+  if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+    perror("Failed to create the virtual mouse");
+    return -1;
+  }
+
+  char sysname[64];
+  if (ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) {
+    perror("Failed to get the virtual mouse's sysname");
+    return -1;
+  }
+
+  // Give udev some time to create the device node
+  mouse->evdev_fd = -1;
+  for (int attempt = 0; attempt < 200 && mouse->evdev_fd < 0; attempt++) {
+    if (find_evdev_node(sysname, mouse->evdev_path,
+                        sizeof(mouse->evdev_path)) == 0) {
+      mouse->evdev_fd = open(mouse->evdev_path, O_RDONLY);
+    }
+    if (mouse->evdev_fd < 0) {
+      usleep(10000);
+    }
+  }
+
+  if (mouse->evdev_fd < 0) {
+    fprintf(stderr, "Failed to open the evdev node of %s\n", sysname);
+    return -1;
+  }
+
+  int clock = CLOCK_MONOTONIC;
+  ioctl(mouse->evdev_fd, EVIOCSCLOCKID, &clock);
+
+  return 0;
+}
+
+/*
+ * Find /dev/input/eventN of a device, given its name, waiting (up to 3s) for
+ * it to show up. Returns an fd open on it, or -1.
+ */
+static inline int open_evdev_by_name(const char *name, char *path,
+                                     size_t size) {
+  for (int attempt = 0; attempt < 300; attempt++) {
+    DIR *dir = opendir("/sys/class/input");
+    struct dirent *entry;
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+      if (strncmp(entry->d_name, "event", 5) != 0) {
+        continue;
+      }
+
+      char name_path[300], device_name[UINPUT_MAX_NAME_SIZE] = {0};
+      snprintf(name_path, sizeof(name_path),
+               "/sys/class/input/%s/device/name", entry->d_name);
+      FILE *file = fopen(name_path, "r");
+      if (file == NULL) {
+        continue;
+      }
+      if (fgets(device_name, sizeof(device_name), file) != NULL) {
+        device_name[strcspn(device_name, "\n")] = '\0';
+      }
+      fclose(file);
+
+      if (strcmp(device_name, name) == 0 &&
+          snprintf(path, size, "/dev/input/%s", entry->d_name) < (int)size) {
+        int fd = open(path, O_RDONLY);
+        if (fd >= 0) {
+          closedir(dir);
+          int clock = CLOCK_MONOTONIC;
+          ioctl(fd, EVIOCSCLOCKID, &clock);
+          return fd;
+        }
+      }
+    }
+    if (dir != NULL) {
+      closedir(dir);
+    }
+    usleep(10000);
+  }
+  return -1;
+}
+
+/*
+ * Read the frames back from the clone that `maccel engine` creates for the
+ * virtual mouse instead, since the engine grabs the mouse's own evdev node.
+ */
+static inline int virtual_mouse_follow_engine(struct virtual_mouse *mouse,
+                                              const char *name) {
+  char clone_name[UINPUT_MAX_NAME_SIZE];
+  snprintf(clone_name, sizeof(clone_name), "maccel engine: %s", name);
+
+  // The engine looks for new mice every 500ms
+  int fd = open_evdev_by_name(clone_name, mouse->evdev_path,
+                              sizeof(mouse->evdev_path));
+  if (fd < 0) {
+    fprintf(stderr, "Failed to find the engine's clone of %s, is it running?\n",
+            name);
+    return -1;
+  }
+
+  close(mouse->evdev_fd);
+  mouse->evdev_fd = fd;
+  return 0;
+}
+
+static inline void virtual_mouse_destroy(struct virtual_mouse *mouse) {
+  close(mouse->evdev_fd);
+  ioctl(mouse->uinput_fd, UI_DEV_DESTROY);
+  close(mouse->uinput_fd);
+}
+
+/* Emit a (x, y) frame, followed by its SYN_REPORT, in a single write */
+static inline int virtual_mouse_move(struct virtual_mouse *mouse, int x,
+                                     int y) {
+  struct input_event frame[3] = {
+      {.type = EV_REL, .code = REL_X, .value = x},
+      {.type = EV_REL, .code = REL_Y, .value = y},
+      {.type = EV_SYN, .code = SYN_REPORT, .value = 0},
+  };
+  if (write(mouse->uinput_fd, frame, sizeof(frame)) != sizeof(frame)) {
+    perror("Failed to write a frame to uinput");
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Block until the next SYN_REPORT arrives on the evdev node, collecting the
+ * frame's (x, y) on the way. Returns -1 if nothing came within `timeout_ms`.
+ */
+static inline int virtual_mouse_read(struct virtual_mouse *mouse, int *x,
+                                     int *y, int timeout_ms) {
+  struct input_event ev;
+  *x = 0;
+  *y = 0;
+
+  for (;;) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(mouse->evdev_fd, &fds);
+    struct timeval timeout = {.tv_sec = timeout_ms / 1000,
+                              .tv_usec = (timeout_ms % 1000) * 1000};
+    if (select(mouse->evdev_fd + 1, &fds, NULL, NULL, &timeout) <= 0) {
+      return -1;
+    }
+
+    if (read(mouse->evdev_fd, &ev, sizeof(ev)) != sizeof(ev)) {
+      perror("Failed to read an event");
+      return -1;
+    }
+
+    if (ev.type == EV_REL && ev.code == REL_X) {
+      *x += ev.value;
+    } else if (ev.type == EV_REL && ev.code == REL_Y) {
+      *y += ev.value;
+    } else if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+      return 0;
+    }
+  }
+}
+
+static inline int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+#endif // !_VIRTUAL_MOUSE_H_
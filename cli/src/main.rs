@@ -1,11 +1,14 @@
+use std::path::PathBuf;
+
 use anyhow::Context;
 use clap::{CommandFactory, Parser};
 use maccel_core::{
+    dump, engine, fit,
     fixedptc::Fpt,
-    persist::{ParamStore, SysFsStore},
+    persist::{EngineStore, ParamStore, SysFsStore},
     subcommads::*,
-    AccelMode, NoAccelParamArgs, Param, ALL_COMMON_PARAMS, ALL_LINEAR_PARAMS, ALL_NATURAL_PARAMS,
-    ALL_SYNCHRONOUS_PARAMS,
+    AccelMode, AllParamArgs, NoAccelParamArgs, Param, ALL_COMMON_PARAMS, ALL_LINEAR_PARAMS,
+    ALL_NATURAL_PARAMS, ALL_SYNCHRONOUS_PARAMS,
 };
 use maccel_tui::run_tui;
 
@@ -15,6 +18,10 @@ use maccel_tui::run_tui;
 struct Cli {
     #[clap(subcommand)]
     command: Option<CLiCommands>,
+    /// Use the parameters of the userspace engine (`maccel engine`, and the
+    /// HID-BPF loader) instead of the kernel module's
+    #[arg(long, global = true)]
+    engine: bool,
 }
 
 #[derive(clap::Subcommand, Default)]
@@ -33,6 +40,34 @@ enum CLiCommands {
         #[clap(subcommand)]
         command: CliSubcommandGetParams,
     },
+    /// Accelerate the mice from userspace, through uinput, for when
+    /// the kernel module can't be loaded (e.g. with Secure Boot)
+    Engine {
+        /// The mice to grab (e.g. /dev/input/event2), every mouse if none
+        devices: Vec<PathBuf>,
+    },
+    /// Find the parameters of a mode whose curve best matches another
+    /// mode's curve (with its current parameters), or points from a file
+    Fit {
+        /// The mode to find the parameters of
+        mode: AccelMode,
+        /// The mode whose curve to match
+        #[arg(long, conflicts_with = "points", required_unless_present = "points")]
+        from: Option<AccelMode>,
+        /// A file of `input_speed sensitivity` lines, the curve to match
+        #[arg(long)]
+        points: Option<PathBuf>,
+        /// A file of recorded input speeds (counts/ms), one per line, to
+        /// weigh the curve by how often the mouse moves at each speed
+        #[arg(long)]
+        speeds: Option<PathBuf>,
+        /// Up to which input speed (counts/ms) to match the other mode's curve
+        #[arg(long, default_value_t = 80.0)]
+        max_speed: f64,
+    },
+    /// Print a snapshot of the module's state as JSON: how it was built,
+    /// its parameters, and each mouse's state, for bug reports
+    Dump,
     /// Generate a completions file for a specified shell
     Completion {
         // The shell for which to generate completions
@@ -60,7 +95,11 @@ fn main() -> anyhow::Result<()> {
     //     .with_writer(File::create("./maccel.log")?)
     //     .init();
 
-    let mut param_store = SysFsStore;
+    let mut param_store: Box<dyn ParamStore> = if args.engine {
+        Box::new(EngineStore)
+    } else {
+        Box::new(SysFsStore)
+    };
 
     match args.command.unwrap_or_default() {
         CLiCommands::Set { command } => match command {
@@ -85,7 +124,7 @@ fn main() -> anyhow::Result<()> {
                     eprintln!();
                 }
             },
-            CliSubcommandSetParams::Mode { mode } => SysFsStore.set_current_accel_mode(mode)?,
+            CliSubcommandSetParams::Mode { mode } => param_store.set_current_accel_mode(mode)?,
         },
         CLiCommands::Get { command } => match command {
             CliSubcommandGetParams::Param { name } => {
@@ -99,49 +138,91 @@ fn main() -> anyhow::Result<()> {
                 command,
             } => match command {
                 GetParamsByModesSubcommands::Linear => {
-                    print_all_params(ALL_LINEAR_PARAMS.iter(), oneline, quiet)?;
+                    print_all_params(&*param_store, ALL_LINEAR_PARAMS.iter(), oneline, quiet)?;
                 }
                 GetParamsByModesSubcommands::Natural => {
-                    print_all_params(ALL_NATURAL_PARAMS.iter(), oneline, quiet)?;
+                    print_all_params(&*param_store, ALL_NATURAL_PARAMS.iter(), oneline, quiet)?;
                 }
                 GetParamsByModesSubcommands::Common => {
-                    print_all_params(ALL_COMMON_PARAMS.iter(), oneline, quiet)?;
+                    print_all_params(&*param_store, ALL_COMMON_PARAMS.iter(), oneline, quiet)?;
                 }
                 GetParamsByModesSubcommands::Synchronous => {
-                    print_all_params(ALL_SYNCHRONOUS_PARAMS.iter(), oneline, quiet)?;
+                    print_all_params(&*param_store, ALL_SYNCHRONOUS_PARAMS.iter(), oneline, quiet)?;
                 }
                 GetParamsByModesSubcommands::NoAccel => {
                     eprintln!(
                         "NOTE: There are no parameters specific here except for the common ones."
                     );
                     eprintln!();
-                    print_all_params(ALL_COMMON_PARAMS.iter(), oneline, quiet)?;
+                    print_all_params(&*param_store, ALL_COMMON_PARAMS.iter(), oneline, quiet)?;
                 }
             },
             CliSubcommandGetParams::Mode => {
-                let mode = SysFsStore.get_current_accel_mode()?;
+                let mode = param_store.get_current_accel_mode()?;
                 println!("{}\n", mode.as_title());
                 match mode {
                     AccelMode::Linear => {
-                        print_all_params(ALL_LINEAR_PARAMS.iter(), false, false)?;
+                        print_all_params(&*param_store, ALL_LINEAR_PARAMS.iter(), false, false)?;
                     }
                     AccelMode::Natural => {
-                        print_all_params(ALL_NATURAL_PARAMS.iter(), false, false)?;
+                        print_all_params(&*param_store, ALL_NATURAL_PARAMS.iter(), false, false)?;
                     }
                     AccelMode::Synchronous => {
-                        print_all_params(ALL_SYNCHRONOUS_PARAMS.iter(), false, false)?;
+                        print_all_params(
+                            &*param_store,
+                            ALL_SYNCHRONOUS_PARAMS.iter(),
+                            false,
+                            false,
+                        )?;
                     }
                     AccelMode::NoAccel => {
                         eprintln!(
                             "NOTE: There are no parameters specific here except for the common ones."
                         );
                         eprintln!();
-                        print_all_params(ALL_COMMON_PARAMS.iter(), false, false)?;
+                        print_all_params(&*param_store, ALL_COMMON_PARAMS.iter(), false, false)?;
                     }
                 }
             }
         },
-        CLiCommands::Tui => run_tui()?,
+        CLiCommands::Tui => {
+            if args.engine {
+                run_tui(EngineStore)?
+            } else {
+                run_tui(SysFsStore)?
+            }
+        }
+        CLiCommands::Engine { devices } => engine::run(&EngineStore, &devices)?,
+        CLiCommands::Fit {
+            mode,
+            from,
+            points,
+            speeds,
+            max_speed,
+        } => {
+            let params = param_store.get_all()?;
+            let mut target = match (from, points) {
+                (Some(from), _) => fit::Target::from_curve(from, &params, max_speed, 256)?,
+                (None, Some(path)) => {
+                    let text = std::fs::read_to_string(&path)
+                        .with_context(|| format!("failed to read {}", path.display()))?;
+                    fit::Target::from_points(&fit::parse_points(&text)?)?
+                }
+                (None, None) => unreachable!("clap requires --from or --points"),
+            };
+            if let Some(path) = speeds {
+                let text = std::fs::read_to_string(&path)
+                    .with_context(|| format!("failed to read {}", path.display()))?;
+                target = target.weighted_by(&fit::parse_speeds(&text)?)?;
+            }
+
+            let fit = fit::fit(mode, &params, &target)?;
+            print_fit(mode, &fit, args.engine);
+        }
+        CLiCommands::Dump => {
+            let dump = dump::decode(&dump::read_dump()?).context("failed to decode the dump")?;
+            println!("{}", dump.to_json());
+        }
         CLiCommands::Completion { shell } => {
             clap_complete::generate(shell, &mut Cli::command(), "maccel", &mut std::io::stdout())
         }
@@ -169,6 +250,7 @@ fn main() -> anyhow::Result<()> {
 }
 
 fn print_all_params<'p>(
+    param_store: &dyn ParamStore,
     params: impl Iterator<Item = &'p Param>,
     oneline: bool,
     quiet: bool,
@@ -177,7 +259,7 @@ fn print_all_params<'p>(
 
     let params = params
         .map(|&p| {
-            SysFsStore.get(p).and_then(|_p: Fpt| {
+            param_store.get(p).and_then(|_p: Fpt| {
                 let value: &str = (&_p).try_into()?;
                 Ok((p.display_name(), value.to_string()))
             })
@@ -196,3 +278,51 @@ fn print_all_params<'p>(
 
     Ok(())
 }
+
+/// With the command that sets them in the same store they were fitted from
+fn print_fit(mode: AccelMode, fit: &fit::Fit, engine: bool) {
+    let value = |params: &AllParamArgs, param: Param| match param {
+        Param::Accel => params.accel,
+        Param::OffsetLinear => params.offset_linear,
+        Param::OutputCap => params.output_cap,
+        Param::DecayRate => params.decay_rate,
+        Param::OffsetNatural => params.offset_natural,
+        Param::Limit => params.limit,
+        Param::Gamma => params.gamma,
+        Param::Smooth => params.smooth,
+        Param::Motivity => params.motivity,
+        Param::SyncSpeed => params.sync_speed,
+        _ => unreachable!("only a mode's own parameters are fitted"),
+    };
+    let (params, subcommand) = match mode {
+        AccelMode::Linear => (ALL_LINEAR_PARAMS, "linear"),
+        AccelMode::Natural => (ALL_NATURAL_PARAMS, "natural"),
+        AccelMode::Synchronous => (ALL_SYNCHRONOUS_PARAMS, "synchronous"),
+        AccelMode::NoAccel => (&[][..], "no-accel"),
+    };
+
+    println!("{}\n", mode.as_title());
+    for &param in params {
+        println!("{}:  \t{}", param.display_name(), value(&fit.params, param));
+    }
+
+    let stats = fit.stats;
+    println!();
+    println!("rms error:  \t{:.5}", stats.rms_error);
+    println!("mean error: \t{:.5}", stats.mean_error);
+    println!(
+        "max error:  \t{:.5} (at {:.2} counts/ms)",
+        stats.max_error, stats.max_error_speed
+    );
+
+    let values: Vec<String> = params
+        .iter()
+        .map(|&param| value(&fit.params, param).to_string())
+        .collect();
+    let maccel = if engine { "maccel --engine" } else { "maccel" };
+    println!();
+    println!(
+        "To use them: {maccel} set all {subcommand} {} && {maccel} set mode {subcommand}",
+        values.join(" ")
+    );
+}
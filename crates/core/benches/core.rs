@@ -0,0 +1,126 @@
+//! What the CLI and the TUI spend on the curves, on crossing the FFI
+//! boundary, and on reading and writing the parameters.
+//!
+//! Run with `make bench_cli` from the repository's root, to compare against
+//! the saved baseline (see bench/criterion.sh).
+
+use std::{hint::black_box, str::FromStr};
+
+use criterion::{BenchmarkId, Criterion, Throughput, criterion_group, criterion_main};
+use maccel_core::{
+    ALL_MODES, AllParamArgs, Param, SensitivityFn,
+    fixedptc::Fpt,
+    persist::{FakeSysfs, ParamStore, SysFsStore},
+    sensitivity,
+};
+
+/// As many speeds as the TUI's graph samples, at most
+const SWEEP_LEN: usize = 1024;
+const MAX_SPEED: f64 = 128.0;
+
+fn params() -> AllParamArgs {
+    AllParamArgs {
+        sens_mult: Fpt::from(1.0),
+        yx_ratio: Fpt::from(1.0),
+        input_dpi: Fpt::from(1600.0),
+        angle_rotation: Fpt::from(0.0),
+        accel: Fpt::from(0.3),
+        offset_linear: Fpt::from(2.0),
+        output_cap: Fpt::from(2.0),
+        decay_rate: Fpt::from(0.1),
+        offset_natural: Fpt::from(2.0),
+        limit: Fpt::from(1.5),
+        gamma: Fpt::from(1.0),
+        smooth: Fpt::from(0.5),
+        motivity: Fpt::from(1.5),
+        sync_speed: Fpt::from(5.0),
+    }
+}
+
+fn speeds() -> Vec<f64> {
+    (0..SWEEP_LEN)
+        .map(|i| i as f64 * MAX_SPEED / SWEEP_LEN as f64)
+        .collect()
+}
+
+/// Sweeping each mode's curve: in one FFI call, and in one call per speed
+fn curve_sweeps(c: &mut Criterion) {
+    let params = params();
+    let speeds = speeds();
+    let mut sens_x = vec![0.0; speeds.len()];
+    let mut sens_y = vec![0.0; speeds.len()];
+
+    let mut group = c.benchmark_group("sweep");
+    group.throughput(Throughput::Elements(speeds.len() as u64));
+
+    for &mode in ALL_MODES {
+        let sens_fn = SensitivityFn::new(mode, &params);
+        group.bench_function(BenchmarkId::new("eval_batch", format!("{mode:?}")), |b| {
+            b.iter(|| sens_fn.eval_batch(black_box(&speeds), &mut sens_x, &mut sens_y))
+        });
+
+        group.bench_function(BenchmarkId::new("sensitivity", format!("{mode:?}")), |b| {
+            b.iter(|| {
+                for &speed in &speeds {
+                    black_box(sensitivity(black_box(speed), mode, &params));
+                }
+            })
+        });
+    }
+
+    group.finish();
+}
+
+/// The conversions to and from `Fpt`, each one a call into the C code
+fn fpt_conversions(c: &mut Criterion) {
+    let mut group = c.benchmark_group("fpt");
+    let value = Fpt::from(1.234567);
+
+    group.bench_function("from_f64", |b| b.iter(|| Fpt::from(black_box(1.234567))));
+    group.bench_function("to_f64", |b| b.iter(|| f64::from(black_box(value))));
+    group.bench_function("to_str", |b| {
+        b.iter(|| <&str>::try_from(black_box(&value)).unwrap().len())
+    });
+    group.bench_function("from_str", |b| {
+        b.iter(|| Fpt::from_str(black_box("5299989643")).unwrap())
+    });
+
+    group.finish();
+}
+
+/// Round trips of the parameters through their files, like `maccel set`
+/// and `maccel get`, and the TUI when it starts or switches modes
+fn sysfs_store(c: &mut Criterion) {
+    let _sysfs = FakeSysfs::install().expect("failed to set up a fake sysfs tree");
+    let mut store = SysFsStore;
+
+    let mut group = c.benchmark_group("sysfs_store");
+
+    group.bench_function("get", |b| {
+        b.iter(|| store.get(black_box(Param::SensMult)).unwrap())
+    });
+    group.bench_function("get_all", |b| b.iter(|| store.get_all().unwrap()));
+    group.bench_function("get_current_accel_mode", |b| {
+        b.iter(|| store.get_current_accel_mode().unwrap())
+    });
+
+    let mut value = 1.0;
+    group.bench_function("set", |b| {
+        b.iter(|| {
+            value = if value == 1.0 { 1.25 } else { 1.0 };
+            store.set(Param::SensMult, black_box(value)).unwrap()
+        })
+    });
+    group.bench_function("set_get", |b| {
+        b.iter(|| {
+            value = if value == 1.0 { 1.25 } else { 1.0 };
+            store.set(Param::SensMult, black_box(value)).unwrap();
+            store.get(Param::SensMult).unwrap()
+        })
+    });
+
+    group.finish();
+}
+
+criterion_group!(benches, curve_sweeps, fpt_conversions, sysfs_store);
+criterion_main!(benches);
@@ -19,6 +19,7 @@ fn main() {
     let mut compiler = cc::Build::new();
     compiler
         .file("src/libmaccel.c")
+        .file("src/engine.c")
         .define("FIXEDPT_BITS", fixedpt_bits);
 
     if cfg!(feature = "dbg") {
@@ -33,4 +34,5 @@ fn main() {
     const DRIVER_DIR: &str = "../../driver";
     println!("cargo:rerun-if-changed={DRIVER_DIR}");
     println!("cargo:rerun-if-changed=src/libmaccel.c");
+    println!("cargo:rerun-if-changed=src/engine.c");
 }
@@ -67,6 +67,12 @@ impl<PS: ParamStore> TuiContext<PS> {
         Ok(())
     }
 
+    pub fn update_current_mode(&mut self, mode: AccelMode) -> anyhow::Result<()> {
+        self.parameter_store.set_current_accel_mode(mode)?;
+        self.current_mode = mode;
+        Ok(())
+    }
+
     pub fn reset_current_parameters(&mut self) {
         for p in self.parameters.iter_mut() {
             p.value = self
@@ -0,0 +1,284 @@
+//! Decodes the snapshot of the module's state that /dev/maccel hands over
+//! to a single ioctl (see driver/dump.h for the format), into JSON.
+//!
+//! The dump describes itself: its fields are named and typed, and its
+//! header says the width of the fixed point numbers in it. So nothing here
+//! depends on how the module, or this crate, were built.
+
+use std::{
+    ffi::{c_int, c_ulong, c_void},
+    fmt::Write,
+    fs,
+    os::fd::AsRawFd,
+};
+
+use anyhow::{Context, anyhow, bail};
+
+const DUMP_MAGIC: &[u8; 4] = b"MACD";
+const DUMP_VERSION: u8 = 1;
+const DUMP_HEADER_LEN: usize = 8;
+
+/// MACCEL_DUMP_MAX
+const DUMP_MAX: usize = 8192;
+
+/// MACCEL_IOCTL_DUMP, i.e. `_IOC(_IOC_READ, 'M', 1, MACCEL_DUMP_MAX)`
+const IOCTL_DUMP: c_ulong =
+    (2 << 30) | ((DUMP_MAX as c_ulong) << 16) | ((b'M' as c_ulong) << 8) | 1;
+
+const DUMP_END: u8 = 0;
+const DUMP_U64: u8 = 1;
+const DUMP_S64: u8 = 2;
+const DUMP_FPT: u8 = 3;
+const DUMP_STR: u8 = 4;
+const DUMP_OBJECT: u8 = 5;
+const DUMP_ARRAY: u8 = 6;
+
+unsafe extern "C" {
+    fn ioctl(fd: c_int, request: c_ulong, ...) -> c_int;
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub enum Value {
+    U64(u64),
+    S64(i64),
+    Float(f64),
+    Str(String),
+    Object(Vec<(String, Value)>),
+    Array(Vec<Value>),
+}
+
+/// Get a dump from the module, as is.
+pub fn read_dump() -> anyhow::Result<Vec<u8>> {
+    let file = fs::File::open("/dev/maccel").context("failed to open /dev/maccel")?;
+    let mut buf = vec![0u8; DUMP_MAX];
+
+    let len = unsafe {
+        ioctl(
+            file.as_raw_fd(),
+            IOCTL_DUMP,
+            buf.as_mut_ptr() as *mut c_void,
+        )
+    };
+    if len < 0 {
+        return Err(std::io::Error::last_os_error()).context(
+            "failed to get a dump from /dev/maccel\n-- Does the loaded module support `maccel dump`?",
+        );
+    }
+
+    buf.truncate(len as usize);
+    Ok(buf)
+}
+
+pub fn decode(dump: &[u8]) -> anyhow::Result<Value> {
+    if dump.len() < DUMP_HEADER_LEN || &dump[..4] != DUMP_MAGIC {
+        bail!("not a maccel dump");
+    }
+    if dump[4] != DUMP_VERSION {
+        bail!("unsupported version of the dump: {}", dump[4]);
+    }
+    let fixedpt_bits = dump[5];
+    if fixedpt_bits != 32 && fixedpt_bits != 64 {
+        bail!("unexpected FIXEDPT_BITS in the dump: {fixedpt_bits}");
+    }
+    let len = u16::from_le_bytes([dump[6], dump[7]]) as usize;
+    if len > dump.len() {
+        bail!("the dump is truncated: {} of {len} bytes", dump.len());
+    }
+
+    let mut reader = Reader {
+        bytes: &dump[DUMP_HEADER_LEN..len],
+        fbits: fixedpt_bits as i32 / 2,
+    };
+    let mut fields = Vec::new();
+    while !reader.bytes.is_empty() {
+        let (ty, name) = reader.key()?;
+        if ty == DUMP_END {
+            bail!("unexpected end of an object at the top level");
+        }
+        fields.push((name, reader.value(ty)?));
+    }
+    Ok(Value::Object(fields))
+}
+
+struct Reader<'a> {
+    bytes: &'a [u8],
+    /// The fractional bits of the dump's fixed point numbers
+    fbits: i32,
+}
+
+impl Reader<'_> {
+    fn take(&mut self, n: usize) -> anyhow::Result<&[u8]> {
+        if n > self.bytes.len() {
+            bail!("the dump ends in the middle of a record");
+        }
+        let (taken, rest) = self.bytes.split_at(n);
+        self.bytes = rest;
+        Ok(taken)
+    }
+
+    fn le(&mut self, n: usize) -> anyhow::Result<u64> {
+        Ok(self
+            .take(n)?
+            .iter()
+            .rev()
+            .fold(0, |value, &byte| (value << 8) | byte as u64))
+    }
+
+    /// A record's type and name, there's no name after a DUMP_END
+    fn key(&mut self) -> anyhow::Result<(u8, String)> {
+        let ty = self.le(1)? as u8;
+        if ty == DUMP_END {
+            return Ok((ty, String::new()));
+        }
+        let name_len = self.le(1)? as usize;
+        let name = String::from_utf8_lossy(self.take(name_len)?).into_owned();
+        Ok((ty, name))
+    }
+
+    fn value(&mut self, ty: u8) -> anyhow::Result<Value> {
+        Ok(match ty {
+            DUMP_U64 => Value::U64(self.le(8)?),
+            DUMP_S64 => Value::S64(self.le(8)? as i64),
+            DUMP_FPT => Value::Float(self.le(8)? as i64 as f64 / 2f64.powi(self.fbits)),
+            DUMP_STR => {
+                let len = self.le(2)? as usize;
+                Value::Str(String::from_utf8_lossy(self.take(len)?).into_owned())
+            }
+            DUMP_OBJECT => {
+                let mut fields = Vec::new();
+                loop {
+                    let (ty, name) = self.key()?;
+                    if ty == DUMP_END {
+                        break Value::Object(fields);
+                    }
+                    fields.push((name, self.value(ty)?));
+                }
+            }
+            DUMP_ARRAY => {
+                let mut items = Vec::new();
+                loop {
+                    let (ty, _) = self.key()?;
+                    if ty == DUMP_END {
+                        break Value::Array(items);
+                    }
+                    items.push(self.value(ty)?);
+                }
+            }
+            ty => return Err(anyhow!("unknown type of record in the dump: {ty}")),
+        })
+    }
+}
+
+impl Value {
+    /// As pretty printed JSON
+    pub fn to_json(&self) -> String {
+        let mut json = String::new();
+        self.write_json(&mut json, 0);
+        json
+    }
+
+    fn write_json(&self, out: &mut String, depth: usize) {
+        let indent = |out: &mut String, depth: usize| {
+            out.push('\n');
+            out.extend(std::iter::repeat_n("  ", depth));
+        };
+
+        match self {
+            Value::U64(v) => write!(out, "{v}").unwrap(),
+            Value::S64(v) => write!(out, "{v}").unwrap(),
+            Value::Float(v) => write!(out, "{v}").unwrap(),
+            Value::Str(s) => write_json_str(out, s),
+            Value::Object(fields) if fields.is_empty() => out.push_str("{}"),
+            Value::Object(fields) => {
+                out.push('{');
+                for (i, (name, value)) in fields.iter().enumerate() {
+                    if i > 0 {
+                        out.push(',');
+                    }
+                    indent(out, depth + 1);
+                    write_json_str(out, name);
+                    out.push_str(": ");
+                    value.write_json(out, depth + 1);
+                }
+                indent(out, depth);
+                out.push('}');
+            }
+            Value::Array(items) if items.is_empty() => out.push_str("[]"),
+            Value::Array(items) => {
+                out.push('[');
+                for (i, value) in items.iter().enumerate() {
+                    if i > 0 {
+                        out.push(',');
+                    }
+                    indent(out, depth + 1);
+                    value.write_json(out, depth + 1);
+                }
+                indent(out, depth);
+                out.push(']');
+            }
+        }
+    }
+}
+
+fn write_json_str(out: &mut String, s: &str) {
+    out.push('"');
+    for c in s.chars() {
+        match c {
+            '"' => out.push_str("\\\""),
+            '\\' => out.push_str("\\\\"),
+            '\n' => out.push_str("\\n"),
+            c if (c as u32) < 0x20 => write!(out, "\\u{:04x}", c as u32).unwrap(),
+            c => out.push(c),
+        }
+    }
+    out.push('"');
+}
+
+#[cfg(test)]
+#[test]
+fn decodes_a_dump_into_json() {
+    fn key(dump: &mut Vec<u8>, ty: u8, name: &str) {
+        dump.push(ty);
+        dump.push(name.len() as u8);
+        dump.extend(name.as_bytes());
+    }
+
+    let mut dump = b"MACD\x01\x20\0\0".to_vec(); // FIXEDPT_BITS = 32
+    key(&mut dump, DUMP_OBJECT, "params");
+    key(&mut dump, DUMP_STR, "mode");
+    dump.extend(6u16.to_le_bytes());
+    dump.extend(b"linear");
+    key(&mut dump, DUMP_FPT, "sens_mult");
+    dump.extend((-(3i64 << 15)).to_le_bytes()); // -1.5 in 16.16
+    dump.push(DUMP_END);
+    key(&mut dump, DUMP_ARRAY, "devices");
+    key(&mut dump, DUMP_OBJECT, "");
+    key(&mut dump, DUMP_S64, "ms_since_last_frame");
+    dump.extend((-1i64).to_le_bytes());
+    dump.push(DUMP_END);
+    dump.push(DUMP_END);
+    key(&mut dump, DUMP_U64, "devices_omitted");
+    dump.extend(2u64.to_le_bytes());
+    let len = dump.len() as u16;
+    dump[6..8].copy_from_slice(&len.to_le_bytes());
+
+    let json = decode(&dump).unwrap().to_json();
+    assert_eq!(
+        json,
+        r#"{
+  "params": {
+    "mode": "linear",
+    "sens_mult": -1.5
+  },
+  "devices": [
+    {
+      "ms_since_last_frame": -1
+    }
+  ],
+  "devices_omitted": 2
+}"#
+    );
+
+    assert!(decode(&dump[..dump.len() - 3]).is_err(), "a truncated dump");
+    assert!(decode(b"MACD\x02\x20\x08\0").is_err(), "an unknown version");
+}
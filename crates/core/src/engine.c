@@ -0,0 +1,524 @@
+#include "../../../driver/accel.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * A userspace alternative to the kernel module, for the kernels that won't
+ * load it: grab the mice through evdev, accelerate their frames with the
+ * same `__f_accelerate` the module uses, and re-emit them through a uinput
+ * clone of each mouse.
+ *
+ * Everything a device needs on the event path (its state and its buffers)
+ * lives in the engine, allocated once; reading, accelerating and writing a
+ * batch of events doesn't allocate.
+ */
+
+#define ENGINE_MAX_DEVICES 16
+/* How many events we read from a device at once */
+#define ENGINE_BATCH 64
+/*
+ * Room for a batch, the incomplete frame left over from the previous one,
+ * and the REL_X, REL_Y and SYN_REPORT that end the frame being built.
+ */
+#define ENGINE_OUT_LEN (ENGINE_BATCH * 2 + 3)
+
+/* The uinput clones are named after their mouse, with this prefix */
+#define ENGINE_NAME_PREFIX "maccel engine: "
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define NLONGS(n) (((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+
+#if FIXEDPT_BITS == 64
+static const int ENGINE_UNITS_PER_MS = 1000000; // nanoseconds
+#else
+static const int ENGINE_UNITS_PER_MS = 1000; // microseconds
+#endif
+
+struct engine_device {
+  bool used;
+  char path[64];
+  int evdev_fd;
+  int uinput_fd;
+
+  struct accel_state state;
+  int64_t last_time;
+
+  /* The frame being collected, until its SYN_REPORT */
+  int x;
+  int y;
+  /* Whether we're skipping events until the end of a dropped frame */
+  bool dropping;
+  /* The buttons that are down, as far as the clone was told */
+  unsigned long keys[NLONGS(KEY_CNT)];
+
+  struct input_event in[ENGINE_BATCH];
+  struct input_event out[ENGINE_OUT_LEN];
+  /* How much of `out` is filled, and where the frame being built starts */
+  int out_len;
+  int frame_start;
+};
+
+struct maccel_engine {
+  int epoll_fd;
+  struct accel_args args;
+  struct engine_device devices[ENGINE_MAX_DEVICES];
+};
+
+struct maccel_engine *maccel_engine_new(void);
+void maccel_engine_free(struct maccel_engine *engine);
+int maccel_engine_add_device(struct maccel_engine *engine, const char *path);
+bool maccel_engine_has_device(struct maccel_engine *engine, const char *path);
+void maccel_engine_set_args(struct maccel_engine *engine,
+                            const struct accel_args *args);
+int maccel_engine_poll(struct maccel_engine *engine, int timeout_ms);
+
+static bool test_bit(unsigned int bit, const unsigned long *bits) {
+  return (bits[bit / BITS_PER_LONG] >> (bit % BITS_PER_LONG)) & 1;
+}
+
+static void assign_bit(unsigned int bit, unsigned long *bits, bool value) {
+  unsigned long mask = 1ul << (bit % BITS_PER_LONG);
+  if (value) {
+    bits[bit / BITS_PER_LONG] |= mask;
+  } else {
+    bits[bit / BITS_PER_LONG] &= ~mask;
+  }
+}
+
+/* Only the devices that move a pointer, not just scroll a wheel */
+static bool is_mouse(int fd, const char *name) {
+  if (strncmp(name, ENGINE_NAME_PREFIX, strlen(ENGINE_NAME_PREFIX)) == 0) {
+    return false; // one of our own clones
+  }
+
+  unsigned long rel_bits[NLONGS(REL_CNT)] = {0};
+  if (ioctl(fd, EVIOCGBIT(EV_REL, sizeof(rel_bits)), rel_bits) < 0) {
+    return false;
+  }
+  return test_bit(REL_X, rel_bits) && test_bit(REL_Y, rel_bits);
+}
+
+/*
+ * Create a uinput device with the same capabilities and ids as the mouse,
+ * so that it's treated (e.g. by libinput's quirks) as the same mouse.
+ */
+static int clone_device(int evdev_fd, const char *name) {
+  int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    return -errno;
+  }
+
+  static const struct {
+    int type;
+    int count;
+    unsigned long request;
+  } types[] = {
+      {EV_KEY, KEY_CNT, UI_SET_KEYBIT},
+      {EV_REL, REL_CNT, UI_SET_RELBIT},
+      {EV_MSC, MSC_CNT, UI_SET_MSCBIT},
+  };
+
+  unsigned long bits[NLONGS(KEY_CNT)];
+  for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+    memset(bits, 0, sizeof(bits));
+    if (ioctl(evdev_fd, EVIOCGBIT(types[t].type, sizeof(bits)), bits) < 0) {
+      continue;
+    }
+    bool any = false;
+    for (int code = 0; code < types[t].count; code++) {
+      if (test_bit(code, bits)) {
+        ioctl(fd, types[t].request, code);
+        any = true;
+      }
+    }
+    if (any) {
+      ioctl(fd, UI_SET_EVBIT, types[t].type);
+    }
+  }
+
+  memset(bits, 0, sizeof(bits));
+  if (ioctl(evdev_fd, EVIOCGPROP(sizeof(bits)), bits) >= 0) {
+    for (int prop = 0; prop < INPUT_PROP_CNT; prop++) {
+      if (test_bit(prop, bits)) {
+        ioctl(fd, UI_SET_PROPBIT, prop);
+      }
+    }
+  }
+
+  struct uinput_setup setup = {0};
+  ioctl(evdev_fd, EVIOCGID, &setup.id);
+  snprintf(setup.name, UINPUT_MAX_NAME_SIZE, ENGINE_NAME_PREFIX "%s", name);
+
+  if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+    int error = -errno;
+    close(fd);
+    return error;
+  }
+
+  return fd;
+}
+
+static void remove_device(struct engine_device *dev) {
+  close(dev->evdev_fd); // also releases the grab, and leaves the epoll set
+  ioctl(dev->uinput_fd, UI_DEV_DESTROY);
+  close(dev->uinput_fd);
+  dev->used = false;
+}
+
+extern struct maccel_engine *maccel_engine_new(void) {
+  struct maccel_engine *engine = calloc(1, sizeof(struct maccel_engine));
+  if (engine == NULL) {
+    return NULL;
+  }
+
+  engine->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (engine->epoll_fd < 0) {
+    free(engine);
+    return NULL;
+  }
+
+  return engine;
+}
+
+extern void maccel_engine_free(struct maccel_engine *engine) {
+  for (int i = 0; i < ENGINE_MAX_DEVICES; i++) {
+    if (engine->devices[i].used) {
+      remove_device(&engine->devices[i]);
+    }
+  }
+  close(engine->epoll_fd);
+  free(engine);
+}
+
+/* Whether the mouse at `path` is grabbed, without touching the device */
+extern bool maccel_engine_has_device(struct maccel_engine *engine,
+                                     const char *path) {
+  for (int i = 0; i < ENGINE_MAX_DEVICES; i++) {
+    struct engine_device *d = &engine->devices[i];
+    if (d->used && strcmp(d->path, path) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Grab the mouse at `path` (/dev/input/eventN) and start accelerating it.
+ * Returns 1 if it was added, 0 if it's not a mouse or already added, and
+ * a negative errno if it couldn't be grabbed or cloned.
+ */
+extern int maccel_engine_add_device(struct maccel_engine *engine,
+                                    const char *path) {
+  struct engine_device *dev = NULL;
+  for (int i = 0; i < ENGINE_MAX_DEVICES; i++) {
+    struct engine_device *d = &engine->devices[i];
+    if (d->used && strcmp(d->path, path) == 0) {
+      return 0;
+    }
+    if (!d->used && dev == NULL) {
+      dev = d;
+    }
+  }
+  if (dev == NULL) {
+    return -ENOSPC;
+  }
+
+  int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    return -errno;
+  }
+
+  char name[UINPUT_MAX_NAME_SIZE] = {0};
+  ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name);
+  if (!is_mouse(fd, name)) {
+    close(fd);
+    return 0;
+  }
+
+  int clock = CLOCK_MONOTONIC;
+  ioctl(fd, EVIOCSCLOCKID, &clock);
+
+  int error;
+  if (ioctl(fd, EVIOCGRAB, 1) < 0) {
+    error = -errno;
+    goto err_close;
+  }
+
+  int uinput_fd = clone_device(fd, name);
+  if (uinput_fd < 0) {
+    error = uinput_fd;
+    goto err_close;
+  }
+
+  memset(dev, 0, sizeof(*dev));
+  dev->used = true;
+  snprintf(dev->path, sizeof(dev->path), "%s", path);
+  dev->evdev_fd = fd;
+  dev->uinput_fd = uinput_fd;
+
+  struct epoll_event event = {.events = EPOLLIN, .data.ptr = dev};
+  if (epoll_ctl(engine->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+    error = -errno;
+    remove_device(dev);
+    return error;
+  }
+
+  return 1;
+
+err_close:
+  close(fd);
+  return error;
+}
+
+/*
+ * Not thread-safe: call it between two `maccel_engine_poll`, which is when
+ * the parameters are reloaded anyway.
+ */
+extern void maccel_engine_set_args(struct maccel_engine *engine,
+                                   const struct accel_args *args) {
+  engine->args = *args;
+}
+
+static void push_event(struct engine_device *dev, int type, int code,
+                       int value) {
+  dev->out[dev->out_len++] =
+      (struct input_event){.type = type, .code = code, .value = value};
+}
+
+/* Accelerate the collected frame, and close it with its SYN_REPORT */
+static void end_frame(struct engine_device *dev, const struct input_event *syn,
+                      struct accel_args args) {
+#if FIXEDPT_BITS == 64
+  int64_t now = syn->input_event_sec * 1000000000ll +
+                syn->input_event_usec * 1000ll;
+#else
+  int64_t now = syn->input_event_sec * 1000000ll + syn->input_event_usec;
+#endif
+
+  int x = dev->x;
+  int y = dev->y;
+  if (x || y) {
+    fpt millisecond =
+        frame_interval_ms(now - dev->last_time, ENGINE_UNITS_PER_MS);
+    __f_accelerate(&x, &y, millisecond, args, &dev->state);
+    dev->last_time = now;
+  }
+
+  // Like the input core, drop the relative events that don't move
+  if (x) {
+    push_event(dev, EV_REL, REL_X, x);
+  }
+  if (y) {
+    push_event(dev, EV_REL, REL_Y, y);
+  }
+  push_event(dev, EV_SYN, SYN_REPORT, 0);
+
+  dev->x = 0;
+  dev->y = 0;
+  dev->frame_start = dev->out_len;
+}
+
+/*
+ * Write out `count` events. uinput takes whole events, but a short write
+ * is still possible, and errno isn't set for one: keep writing the rest.
+ * Returns 0, or a negative errno.
+ */
+static int write_events(int fd, const struct input_event *events, int count) {
+  const char *buf = (const char *)events;
+  size_t left = count * sizeof(struct input_event);
+
+  while (left > 0) {
+    ssize_t written = write(fd, buf, left);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -errno;
+    }
+    if (written == 0) {
+      return -EIO;
+    }
+    buf += written;
+    left -= written;
+  }
+  return 0;
+}
+
+/* Write the complete frames, keeping the one being built for later */
+static int flush_frames(struct engine_device *dev) {
+  for (int i = 0; i < dev->frame_start; i++) {
+    const struct input_event *ev = &dev->out[i];
+    if (ev->type == EV_KEY && ev->code < KEY_CNT && ev->value != 2) {
+      assign_bit(ev->code, dev->keys, ev->value);
+    }
+  }
+
+  if (dev->frame_start > 0) {
+    int error = write_events(dev->uinput_fd, dev->out, dev->frame_start);
+    if (error) {
+      return error;
+    }
+  }
+
+  int pending = dev->out_len - dev->frame_start;
+  memmove(dev->out, dev->out + dev->frame_start,
+          pending * sizeof(struct input_event));
+  dev->out_len = pending;
+  dev->frame_start = 0;
+  return 0;
+}
+
+/*
+ * After a SYN_DROPPED, the clone may have missed a press or a release: ask
+ * the mouse which buttons are down (EVIOCGKEY), and send the clone what
+ * differs, in a frame of its own. Returns 0, or a negative errno.
+ */
+static int resync_keys(struct engine_device *dev) {
+  unsigned long keys[NLONGS(KEY_CNT)] = {0};
+  if (ioctl(dev->evdev_fd, EVIOCGKEY(sizeof(keys)), keys) < 0) {
+    return 0; // e.g. unplugged, which the next read finds out
+  }
+
+  bool changed = false;
+  for (int code = 0; code < KEY_CNT; code++) {
+    bool down = test_bit(code, keys);
+    if (down == test_bit(code, dev->keys)) {
+      continue;
+    }
+
+    // Keep room for the SYN_REPORT
+    if (dev->out_len + 1 >= ENGINE_OUT_LEN) {
+      dev->frame_start = dev->out_len;
+      int error = flush_frames(dev);
+      if (error) {
+        return error;
+      }
+    }
+    push_event(dev, EV_KEY, code, down);
+    changed = true;
+  }
+
+  if (changed) {
+    push_event(dev, EV_SYN, SYN_REPORT, 0);
+    dev->frame_start = dev->out_len;
+  }
+  return 0;
+}
+
+/* Returns how many frames were accelerated, or a negative errno */
+static int process_batch(struct engine_device *dev, int count,
+                         struct accel_args args) {
+  int frames = 0;
+
+  for (int i = 0; i < count; i++) {
+    const struct input_event *ev = &dev->in[i];
+
+    if (dev->dropping) {
+      // See SYN_DROPPED in the kernel's Documentation/input/event-codes.rst
+      if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+        dev->dropping = false;
+        int error = resync_keys(dev);
+        if (error) {
+          return error;
+        }
+      }
+      continue;
+    }
+
+    switch (ev->type) {
+    case EV_REL:
+      if (ev->code == REL_X) {
+        dev->x += ev->value;
+        continue;
+      }
+      if (ev->code == REL_Y) {
+        dev->y += ev->value;
+        continue;
+      }
+      break;
+    case EV_SYN:
+      if (ev->code == SYN_REPORT) {
+        end_frame(dev, ev, args);
+        frames++;
+        continue;
+      }
+      if (ev->code == SYN_DROPPED) {
+        dev->out_len = dev->frame_start;
+        dev->x = 0;
+        dev->y = 0;
+        dev->dropping = true;
+        continue;
+      }
+      break;
+    }
+
+    // An absurdly long frame: pass it on before it overflows the buffer
+    if (dev->out_len + 3 >= ENGINE_OUT_LEN) {
+      dev->frame_start = dev->out_len;
+      int error = flush_frames(dev);
+      if (error) {
+        return error;
+      }
+    }
+    dev->out[dev->out_len++] = *ev;
+  }
+
+  int error = flush_frames(dev);
+  return error ? error : frames;
+}
+
+/*
+ * Wait up to `timeout_ms` for events, and accelerate everything that's
+ * ready. Returns how many frames were accelerated, or a negative errno.
+ * A mouse that gets unplugged, or whose clone can't be written to, is
+ * dropped along the way.
+ */
+extern int maccel_engine_poll(struct maccel_engine *engine, int timeout_ms) {
+  struct epoll_event ready[ENGINE_MAX_DEVICES];
+  int n = epoll_wait(engine->epoll_fd, ready, ENGINE_MAX_DEVICES, timeout_ms);
+  if (n < 0) {
+    return errno == EINTR ? 0 : -errno;
+  }
+
+  int frames = 0;
+  for (int i = 0; i < n; i++) {
+    struct engine_device *dev = ready[i].data.ptr;
+
+    for (;;) {
+      ssize_t size = read(dev->evdev_fd, dev->in, sizeof(dev->in));
+      if (size < 0) {
+        if (errno != EAGAIN && errno != EINTR) {
+          remove_device(dev); // e.g. ENODEV, it's been unplugged
+        }
+        break;
+      }
+
+      int count = size / sizeof(struct input_event);
+      int processed = process_batch(dev, count, engine->args);
+      if (processed < 0) {
+        // Only this mouse is affected, it's grabbed again at the next reload
+        fprintf(stderr, "dropped %s: failed to write to its clone: %s\n",
+                dev->path, strerror(-processed));
+        remove_device(dev);
+        break;
+      }
+      frames += processed;
+
+      if (count < ENGINE_BATCH) {
+        break; // drained
+      }
+    }
+  }
+
+  return frames;
+}
@@ -0,0 +1,215 @@
+//! A userspace alternative to the kernel module, for the kernels that can't
+//! load it (e.g. with Secure Boot): it grabs the mice, accelerates them with
+//! the driver's own `__f_accelerate`, and re-emits their events through
+//! uinput clones. See `engine.c`.
+//!
+//! It reads its parameters from the [`EngineStore`](crate::persist::EngineStore),
+//! where `maccel set --engine` and `maccel tui --engine` put them, and reloads
+//! them when they change.
+
+use std::{
+    collections::HashMap,
+    ffi::{CString, c_char, c_int},
+    fs,
+    os::unix::fs::MetadataExt,
+    path::{Path, PathBuf},
+    ptr::NonNull,
+    time::{Duration, Instant},
+};
+
+use anyhow::{Context, anyhow, bail};
+
+use crate::{
+    AccelMode, AccelParams, AllParamArgs,
+    persist::{self, ParamStore},
+};
+
+/// How often we look for changed parameters, and for newly plugged mice
+const RELOAD_INTERVAL: Duration = Duration::from_millis(500);
+
+#[repr(C)]
+struct CEngine {
+    _private: [u8; 0],
+}
+
+unsafe extern "C" {
+    fn maccel_engine_new() -> *mut CEngine;
+    fn maccel_engine_free(engine: *mut CEngine);
+    fn maccel_engine_add_device(engine: *mut CEngine, path: *const c_char) -> c_int;
+    fn maccel_engine_has_device(engine: *mut CEngine, path: *const c_char) -> bool;
+    fn maccel_engine_set_args(engine: *mut CEngine, args: *const AccelParams);
+    fn maccel_engine_poll(engine: *mut CEngine, timeout_ms: c_int) -> c_int;
+}
+
+pub struct Engine {
+    engine: NonNull<CEngine>,
+}
+
+impl Engine {
+    pub fn new() -> anyhow::Result<Self> {
+        let engine = NonNull::new(unsafe { maccel_engine_new() })
+            .context("failed to set up the engine's epoll instance")?;
+        Ok(Self { engine })
+    }
+
+    /// Grab the mouse at `path` (/dev/input/eventN).
+    /// Returns false if it's not a mouse, or it's already grabbed.
+    pub fn add_device(&mut self, path: &Path) -> anyhow::Result<bool> {
+        let cpath = c_path(path)?;
+        let ret = unsafe { maccel_engine_add_device(self.engine.as_ptr(), cpath.as_ptr()) };
+        if ret < 0 {
+            return Err(std::io::Error::from_raw_os_error(-ret)).with_context(|| {
+                anyhow!(
+                    "failed to grab {} and create its virtual clone\n-- Make sure that the user can read /dev/input/event* and write /dev/uinput.",
+                    path.display()
+                )
+            });
+        }
+        Ok(ret == 1)
+    }
+
+    /// Whether the mouse at `path` is grabbed: it's not anymore once it's
+    /// unplugged, or dropped because its clone failed.
+    pub fn has_device(&self, path: &Path) -> anyhow::Result<bool> {
+        let cpath = c_path(path)?;
+        Ok(unsafe { maccel_engine_has_device(self.engine.as_ptr(), cpath.as_ptr()) })
+    }
+
+    pub fn set_params(&mut self, mode: AccelMode, params: &AllParamArgs) {
+        let args = params.convert_to_accel_args(mode);
+        unsafe { maccel_engine_set_args(self.engine.as_ptr(), &args) };
+    }
+
+    /// Accelerate whatever the mice send within `timeout`,
+    /// returns how many frames that was.
+    pub fn poll(&mut self, timeout: Duration) -> anyhow::Result<usize> {
+        let timeout_ms = timeout.as_millis().min(c_int::MAX as u128) as c_int;
+        let ret = unsafe { maccel_engine_poll(self.engine.as_ptr(), timeout_ms) };
+        if ret < 0 {
+            return Err(std::io::Error::from_raw_os_error(-ret))
+                .context("failed to pass on the accelerated events");
+        }
+        Ok(ret as usize)
+    }
+}
+
+impl Drop for Engine {
+    fn drop(&mut self) {
+        unsafe { maccel_engine_free(self.engine.as_ptr()) };
+    }
+}
+
+fn c_path(path: &Path) -> anyhow::Result<CString> {
+    CString::new(path.as_os_str().as_encoded_bytes()).context("Failed to convert to a C string")
+}
+
+fn read_params(store: &impl ParamStore) -> anyhow::Result<(AccelMode, AllParamArgs)> {
+    Ok((store.get_current_accel_mode()?, store.get_all()?))
+}
+
+fn input_devices() -> anyhow::Result<Vec<PathBuf>> {
+    let mut devices = fs::read_dir("/dev/input")
+        .context("failed to list /dev/input")?
+        .filter_map(Result::ok)
+        .map(|entry| entry.path())
+        .filter(|path| {
+            path.file_name()
+                .and_then(|name| name.to_str())
+                .is_some_and(|name| name.starts_with("event"))
+        })
+        .collect::<Vec<_>>();
+    devices.sort();
+    Ok(devices)
+}
+
+/// When the device node at `path` last changed: it's replaced when the device
+/// is plugged again, and its ctime moves when its permissions change, the
+/// two reasons why a device we passed over could be grabbed now.
+fn node_changed_at(path: &Path) -> Option<(i64, i64)> {
+    let meta = fs::metadata(path).ok()?;
+    Some((meta.ctime(), meta.ctime_nsec()))
+}
+
+/// The module would accelerate the mice we grab, then our clones of them
+fn ensure_module_not_loaded() -> anyhow::Result<()> {
+    if persist::module_is_loaded() {
+        bail!(
+            "the maccel kernel module is loaded, it already accelerates the mice\n-- Unload it before running the engine: `sudo rmmod maccel`"
+        );
+    }
+    Ok(())
+}
+
+/// Accelerate the given mice, or every mouse (including the ones plugged
+/// later) if none are given, until something goes wrong.
+///
+/// A mouse that's dropped along the way (e.g. its clone failed) is grabbed
+/// again at the next reload, if it's still there.
+pub fn run(store: &impl ParamStore, devices: &[PathBuf]) -> anyhow::Result<()> {
+    ensure_module_not_loaded()?;
+
+    let mut engine = Engine::new()?;
+
+    for path in devices {
+        if !engine.add_device(path)? {
+            bail!("{} is not a mouse", path.display());
+        }
+        eprintln!("grabbed {}", path.display());
+    }
+
+    let mut current = None;
+    // The devices that aren't mice, or aren't ours to open, and when their
+    // node last changed: they're not opened again until it changes
+    let mut passed_over = HashMap::new();
+    loop {
+        ensure_module_not_loaded()?;
+
+        let params = read_params(store).context("failed to read the parameters")?;
+        if current != Some(params) {
+            let (mode, args) = &params;
+            engine.set_params(*mode, args);
+            current = Some(params);
+            eprintln!("using the {} parameters", mode.as_title());
+        }
+
+        let candidates = if devices.is_empty() {
+            input_devices()?
+        } else {
+            devices.to_vec()
+        };
+        passed_over.retain(|path, _| candidates.contains(path));
+        for path in candidates {
+            if engine.has_device(&path)? {
+                continue;
+            }
+            let changed_at = node_changed_at(&path);
+            if passed_over.get(&path) == Some(&changed_at) {
+                continue;
+            }
+
+            match engine.add_device(&path) {
+                Ok(true) => {
+                    passed_over.remove(&path);
+                    eprintln!("grabbed {}", path.display());
+                }
+                Ok(false) => {
+                    passed_over.insert(path, changed_at);
+                }
+                // Not every device is ours to open, e.g. some are root only
+                Err(err) => {
+                    eprintln!("skipped {}: {:#}", path.display(), err);
+                    passed_over.insert(path, changed_at);
+                }
+            }
+        }
+
+        let deadline = Instant::now() + RELOAD_INTERVAL;
+        loop {
+            let now = Instant::now();
+            if now >= deadline {
+                break;
+            }
+            engine.poll(deadline - now)?;
+        }
+    }
+}
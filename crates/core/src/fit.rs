@@ -0,0 +1,539 @@
+//! Find the parameters of a mode whose curve best matches a target: another
+//! mode's curve, or points taken from elsewhere (e.g. another tool's curve).
+//!
+//! The curves are evaluated exactly as the driver does, in fixed-point,
+//! through [`SensitivityFn::eval_batch`]. The search is a grid over the
+//! mode's parameters, zoomed in around the best candidate round after round,
+//! with every round's candidates split across all the cores.
+
+use std::{num::NonZero, thread};
+
+use anyhow::Context;
+
+use crate::{
+    AccelMode, AllParamArgs, Param, SensitivityFn, fixedptc::Fpt, params::validate_param_value,
+};
+
+/// Candidates per parameter, over its whole range
+const COARSE_GRID_SIZE: usize = 9;
+/// How many of the best coarse candidates get refined
+const SEEDS: usize = 16;
+/// Candidates per parameter, around a candidate being refined
+const REFINE_GRID_SIZE: usize = 3;
+/// A refining round moves to the best candidate around, or halves the
+/// range to look at if there's none better
+const REFINE_ROUNDS: usize = 60;
+/// The parameters are printed, and so set, with 5 decimals. It also keeps
+/// the candidates away from the values so small that the fixed-point
+/// arithmetic overflows on them (e.g. a SMOOTH of 1e-10).
+const RESOLUTION: f64 = 1e-5;
+
+/// What a curve should look like: its sensitivity at some input speeds,
+/// and how much each of them matters.
+#[derive(Debug, Clone, PartialEq)]
+pub struct Target {
+    speeds: Vec<f64>,
+    sens: Vec<f64>,
+    weights: Vec<f64>,
+}
+
+impl Target {
+    /// `(input speed, sensitivity)` points, in any order
+    pub fn from_points(points: &[(f64, f64)]) -> anyhow::Result<Self> {
+        if points.is_empty() {
+            anyhow::bail!("there are no points to fit");
+        }
+
+        let mut points = points.to_vec();
+        points.sort_by(|a, b| a.0.total_cmp(&b.0));
+
+        Ok(Self {
+            speeds: points.iter().map(|p| p.0).collect(),
+            sens: points.iter().map(|p| p.1).collect(),
+            weights: vec![1.0; points.len()],
+        })
+    }
+
+    /// The curve of `mode` with `params`, sampled from 0 to `max_speed`
+    pub fn from_curve(
+        mode: AccelMode,
+        params: &AllParamArgs,
+        max_speed: f64,
+        samples: usize,
+    ) -> anyhow::Result<Self> {
+        if max_speed <= 0.0 || samples < 2 {
+            anyhow::bail!("the curve must be sampled at 2 speeds or more, up to a positive speed");
+        }
+
+        let speeds: Vec<f64> = (0..samples)
+            .map(|i| max_speed * i as f64 / (samples - 1) as f64)
+            .collect();
+        let mut sens = vec![0.0; samples];
+        let mut sens_y = vec![0.0; samples];
+        SensitivityFn::new(mode, params).eval_batch(&speeds, &mut sens, &mut sens_y);
+
+        Ok(Self {
+            speeds,
+            sens,
+            weights: vec![1.0; samples],
+        })
+    }
+
+    /// Weigh every point by how often the mouse moves at (about) its speed,
+    /// according to `recorded_speeds`: the points nobody moves at don't count.
+    pub fn weighted_by(mut self, recorded_speeds: &[f64]) -> anyhow::Result<Self> {
+        self.weights.iter_mut().for_each(|w| *w = 0.0);
+
+        let last = self.speeds.len() - 1;
+        for &speed in recorded_speeds {
+            if speed < self.speeds[0] || speed > self.speeds[last] {
+                continue;
+            }
+            let i = self.speeds.partition_point(|&s| s < speed).min(last);
+            let nearest = if i > 0 && speed - self.speeds[i - 1] < self.speeds[i] - speed {
+                i - 1
+            } else {
+                i
+            };
+            self.weights[nearest] += 1.0;
+        }
+
+        if self.weights.iter().all(|&w| w == 0.0) {
+            anyhow::bail!(
+                "none of the recorded speeds are between {} and {} counts/ms",
+                self.speeds[0],
+                self.speeds[last]
+            );
+        }
+        Ok(self)
+    }
+
+    pub fn len(&self) -> usize {
+        self.speeds.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.speeds.is_empty()
+    }
+
+    fn error(&self, sens: &[f64]) -> f64 {
+        sens.iter()
+            .zip(&self.sens)
+            .zip(&self.weights)
+            .map(|((actual, expected), weight)| weight * (actual - expected).powi(2))
+            .sum()
+    }
+}
+
+/// How far the fitted curve is from the target, on the points that count
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct FitStats {
+    /// Root mean square of the errors, weighted
+    pub rms_error: f64,
+    /// Mean of the absolute errors, weighted
+    pub mean_error: f64,
+    pub max_error: f64,
+    /// The input speed of the `max_error`
+    pub max_error_speed: f64,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct Fit {
+    pub params: AllParamArgs,
+    pub stats: FitStats,
+}
+
+/// The parameters of `mode` searched by a fit, and the range of each
+fn search_space(mode: AccelMode) -> &'static [(Param, f64, f64)] {
+    match mode {
+        AccelMode::Linear => &[
+            (Param::Accel, 0.0, 1.0),
+            (Param::OffsetLinear, 0.0, 50.0),
+            (Param::OutputCap, 0.0, 10.0),
+        ],
+        AccelMode::Natural => &[
+            (Param::DecayRate, 0.001, 1.0),
+            (Param::OffsetNatural, 0.0, 50.0),
+            (Param::Limit, 1.0, 10.0),
+        ],
+        AccelMode::Synchronous => &[
+            (Param::Gamma, 0.1, 10.0),
+            (Param::Smooth, 0.0, 1.0),
+            (Param::Motivity, 1.01, 10.0),
+            (Param::SyncSpeed, 0.1, 100.0),
+        ],
+        AccelMode::NoAccel => &[],
+    }
+}
+
+fn param_mut(params: &mut AllParamArgs, param: Param) -> &mut Fpt {
+    match param {
+        Param::SensMult => &mut params.sens_mult,
+        Param::YxRatio => &mut params.yx_ratio,
+        Param::InputDpi => &mut params.input_dpi,
+        Param::AngleRotation => &mut params.angle_rotation,
+        Param::Accel => &mut params.accel,
+        Param::OffsetLinear => &mut params.offset_linear,
+        Param::OutputCap => &mut params.output_cap,
+        Param::DecayRate => &mut params.decay_rate,
+        Param::OffsetNatural => &mut params.offset_natural,
+        Param::Limit => &mut params.limit,
+        Param::Gamma => &mut params.gamma,
+        Param::Smooth => &mut params.smooth,
+        Param::Motivity => &mut params.motivity,
+        Param::SyncSpeed => &mut params.sync_speed,
+    }
+}
+
+/// The values of the parameters in `space`, rounded to the `RESOLUTION`,
+/// `None` if they're not valid.
+fn with_values(
+    base: &AllParamArgs,
+    space: &[(Param, f64, f64)],
+    values: impl Iterator<Item = f64>,
+) -> Option<AllParamArgs> {
+    let mut params = *base;
+    for (&(param, _, _), value) in space.iter().zip(values) {
+        let value = (value / RESOLUTION).round() * RESOLUTION;
+        validate_param_value(param, value).ok()?;
+        *param_mut(&mut params, param) = Fpt::from(value);
+    }
+    Some(params)
+}
+
+/// The candidate number `index` of a `grid_size`^n grid over `ranges`
+fn grid_values(ranges: &[(f64, f64)], grid_size: usize, mut index: usize) -> Vec<f64> {
+    ranges
+        .iter()
+        .map(|&(lo, hi)| {
+            let value = lo + (hi - lo) * (index % grid_size) as f64 / (grid_size - 1) as f64;
+            index /= grid_size;
+            value
+        })
+        .collect()
+}
+
+/// Evaluates candidates against a target, without allocating for each
+struct Evaluator<'t> {
+    mode: AccelMode,
+    target: &'t Target,
+    sens_x: Vec<f64>,
+    sens_y: Vec<f64>,
+}
+
+impl<'t> Evaluator<'t> {
+    fn new(mode: AccelMode, target: &'t Target) -> Self {
+        Self {
+            mode,
+            target,
+            sens_x: vec![0.0; target.len()],
+            sens_y: vec![0.0; target.len()],
+        }
+    }
+
+    fn error(&mut self, params: &AllParamArgs) -> f64 {
+        SensitivityFn::new(self.mode, params).eval_batch(
+            &self.target.speeds,
+            &mut self.sens_x,
+            &mut self.sens_y,
+        );
+        let error = self.target.error(&self.sens_x);
+        if error.is_finite() {
+            error
+        } else {
+            f64::INFINITY
+        }
+    }
+}
+
+/// Keep the `n` best candidates, best first
+fn keep_best(candidates: &mut Vec<Candidate>, n: usize) {
+    candidates.sort_by(|a, b| a.0.total_cmp(&b.0));
+    candidates.truncate(n);
+}
+
+/// A set of parameters and its error
+type Candidate = (f64, AllParamArgs);
+
+/// Zoom in around `seed`, starting from a step of the coarse grid
+fn refine(
+    evaluator: &mut Evaluator<'_>,
+    base: &AllParamArgs,
+    space: &[(Param, f64, f64)],
+    seed: Candidate,
+) -> Candidate {
+    let mut best = seed;
+    let mut steps: Vec<f64> = space
+        .iter()
+        .map(|&(_, lo, hi)| (hi - lo) / (COARSE_GRID_SIZE - 1) as f64)
+        .collect();
+
+    for _ in 0..REFINE_ROUNDS {
+        let mut center = best.1;
+        let ranges: Vec<(f64, f64)> = space
+            .iter()
+            .zip(&steps)
+            .map(|(&(param, lo, hi), step)| {
+                let value = f64::from(*param_mut(&mut center, param));
+                ((value - step).max(lo), (value + step).min(hi))
+            })
+            .collect();
+
+        let mut moved = false;
+        for index in 0..REFINE_GRID_SIZE.pow(space.len() as u32) {
+            let values = grid_values(&ranges, REFINE_GRID_SIZE, index);
+            if let Some(params) = with_values(base, space, values.into_iter()) {
+                let error = evaluator.error(&params);
+                if error < best.0 {
+                    best = (error, params);
+                    moved = true;
+                }
+            }
+        }
+
+        // Follow the slope at the same scale, or look closer
+        if !moved {
+            if steps.iter().all(|&step| step < RESOLUTION) {
+                break;
+            }
+            steps.iter_mut().for_each(|step| *step /= 2.0);
+        }
+    }
+
+    best
+}
+
+/// Split `items` in (about) one chunk per core, run `work` on every chunk in
+/// its own thread, and collect what they return.
+fn in_parallel<I: Sync, R: Send>(items: &[I], work: impl Fn(&[I]) -> R + Sync) -> Vec<R> {
+    let threads = thread::available_parallelism().map_or(1, NonZero::get);
+    let chunk_size = items.len().div_ceil(threads).max(1);
+
+    thread::scope(|scope| {
+        let workers: Vec<_> = items
+            .chunks(chunk_size)
+            .map(|chunk| scope.spawn(|| work(chunk)))
+            .collect();
+        workers
+            .into_iter()
+            .map(|worker| worker.join().expect("a fitting thread panicked"))
+            .collect()
+    })
+}
+
+/// Fit the parameters of `mode` to `target`, keeping the common parameters
+/// (and the other modes') of `base`.
+///
+/// A coarse grid over the whole range of every parameter finds the most
+/// promising candidates, then each of them is refined on its own; both
+/// steps are spread over all the cores.
+pub fn fit(mode: AccelMode, base: &AllParamArgs, target: &Target) -> anyhow::Result<Fit> {
+    let space = search_space(mode);
+    if space.is_empty() {
+        anyhow::bail!(
+            "there is nothing to fit for {}, it only has the common parameters",
+            mode.as_title()
+        );
+    }
+    if target.is_empty() {
+        anyhow::bail!("there are no points to fit");
+    }
+
+    let bounds: Vec<(f64, f64)> = space.iter().map(|&(_, lo, hi)| (lo, hi)).collect();
+    let indices: Vec<usize> = (0..COARSE_GRID_SIZE.pow(space.len() as u32)).collect();
+
+    let mut seeds: Vec<Candidate> = in_parallel(&indices, |indices| {
+        let mut evaluator = Evaluator::new(mode, target);
+        let mut best = Vec::new();
+        for &index in indices {
+            let values = grid_values(&bounds, COARSE_GRID_SIZE, index);
+            if let Some(params) = with_values(base, space, values.into_iter()) {
+                best.push((evaluator.error(&params), params));
+            }
+            if best.len() >= 4 * SEEDS {
+                keep_best(&mut best, SEEDS);
+            }
+        }
+        keep_best(&mut best, SEEDS);
+        best
+    })
+    .into_iter()
+    .flatten()
+    .filter(|(error, _)| error.is_finite())
+    .collect();
+    keep_best(&mut seeds, SEEDS);
+
+    if seeds.is_empty() {
+        anyhow::bail!("none of the candidate parameters make a valid curve");
+    }
+
+    let mut best: Vec<Candidate> = in_parallel(&seeds, |seeds| {
+        let mut evaluator = Evaluator::new(mode, target);
+        seeds
+            .iter()
+            .map(|&seed| refine(&mut evaluator, base, space, seed))
+            .collect::<Vec<_>>()
+    })
+    .into_iter()
+    .flatten()
+    .collect();
+    keep_best(&mut best, 1);
+
+    let (_, params) = best[0];
+    Ok(Fit {
+        params,
+        stats: stats(mode, &params, target),
+    })
+}
+
+fn stats(mode: AccelMode, params: &AllParamArgs, target: &Target) -> FitStats {
+    let mut sens_x = vec![0.0; target.len()];
+    let mut sens_y = vec![0.0; target.len()];
+    SensitivityFn::new(mode, params).eval_batch(&target.speeds, &mut sens_x, &mut sens_y);
+
+    let total_weight: f64 = target.weights.iter().sum();
+    let mut stats = FitStats {
+        rms_error: (target.error(&sens_x) / total_weight).sqrt(),
+        mean_error: 0.0,
+        max_error: 0.0,
+        max_error_speed: target.speeds[0],
+    };
+
+    for i in 0..target.len() {
+        if target.weights[i] == 0.0 {
+            continue;
+        }
+        let error = (sens_x[i] - target.sens[i]).abs();
+        stats.mean_error += target.weights[i] * error / total_weight;
+        if error > stats.max_error {
+            stats.max_error = error;
+            stats.max_error_speed = target.speeds[i];
+        }
+    }
+
+    stats
+}
+
+/// Parse lines of numbers, separated by whitespace or commas, skipping the
+/// empty lines and `#` comments. Every line must have `columns` numbers.
+fn parse_columns(text: &str, columns: usize) -> anyhow::Result<Vec<Vec<f64>>> {
+    text.lines()
+        .enumerate()
+        .map(|(n, line)| (n + 1, line.split('#').next().unwrap_or("").trim()))
+        .filter(|(_, line)| !line.is_empty())
+        .map(|(n, line)| {
+            let numbers = line
+                .split(|c: char| c == ',' || c.is_whitespace())
+                .filter(|s| !s.is_empty())
+                .map(|s| s.parse::<f64>())
+                .collect::<Result<Vec<_>, _>>()
+                .with_context(|| format!("line {n}: expected numbers, got {line:?}"))?;
+            if numbers.len() != columns {
+                anyhow::bail!(
+                    "line {n}: expected {columns} numbers, got {}",
+                    numbers.len()
+                );
+            }
+            Ok(numbers)
+        })
+        .collect()
+}
+
+/// Parse `input_speed sensitivity` lines, e.g. `12.5, 1.31`
+pub fn parse_points(text: &str) -> anyhow::Result<Vec<(f64, f64)>> {
+    Ok(parse_columns(text, 2)?
+        .into_iter()
+        .map(|point| (point[0], point[1]))
+        .collect())
+}
+
+/// Parse a recording of input speeds (counts/ms), one per line
+pub fn parse_speeds(text: &str) -> anyhow::Result<Vec<f64>> {
+    Ok(parse_columns(text, 1)?
+        .into_iter()
+        .map(|speed| speed[0])
+        .collect())
+}
+
+#[cfg(test)]
+fn test_params() -> AllParamArgs {
+    AllParamArgs {
+        sens_mult: Fpt::from(1.0),
+        yx_ratio: Fpt::from(1.0),
+        input_dpi: Fpt::from(1000.0),
+        angle_rotation: Fpt::from(0.0),
+        accel: Fpt::from(0.0),
+        offset_linear: Fpt::from(0.0),
+        output_cap: Fpt::from(0.0),
+        decay_rate: Fpt::from(0.1),
+        offset_natural: Fpt::from(0.0),
+        limit: Fpt::from(1.5),
+        gamma: Fpt::from(1.0),
+        smooth: Fpt::from(0.5),
+        motivity: Fpt::from(1.5),
+        sync_speed: Fpt::from(5.0),
+    }
+}
+
+#[cfg(test)]
+#[test]
+fn fits_a_curve_of_the_same_mode_back() {
+    let mut params = test_params();
+    params.decay_rate = Fpt::from(0.25);
+    params.offset_natural = Fpt::from(4.0);
+    params.limit = Fpt::from(2.0);
+
+    let target = Target::from_curve(AccelMode::Natural, &params, 80.0, 128).unwrap();
+    let fit = fit(AccelMode::Natural, &test_params(), &target).unwrap();
+
+    assert!(fit.stats.max_error < 0.01, "{fit:?}");
+    assert!((f64::from(fit.params.limit) - 2.0).abs() < 0.05, "{fit:?}");
+    // The common parameters are untouched
+    assert_eq!(fit.params.sens_mult, params.sens_mult);
+}
+
+#[cfg(test)]
+#[test]
+fn fits_another_modes_curve() {
+    let mut params = test_params();
+    params.accel = Fpt::from(0.05);
+    params.offset_linear = Fpt::from(2.0);
+    params.output_cap = Fpt::from(2.0);
+
+    let target = Target::from_curve(AccelMode::Linear, &params, 60.0, 128).unwrap();
+    let fit = fit(AccelMode::Synchronous, &params, &target).unwrap();
+
+    let default_error = stats(AccelMode::Synchronous, &params, &target).rms_error;
+    assert!(fit.stats.rms_error < default_error / 2.0, "{:?}", fit.stats);
+}
+
+#[cfg(test)]
+#[test]
+fn recorded_speeds_weigh_the_nearest_points() {
+    let target = Target::from_points(&[(10.0, 1.0), (0.0, 1.0), (20.0, 1.0)])
+        .unwrap()
+        .weighted_by(&[1.0, 4.0, 9.0, 11.0, 30.0])
+        .unwrap();
+
+    assert_eq!(target.speeds, [0.0, 10.0, 20.0]);
+    assert_eq!(target.weights, [2.0, 2.0, 0.0]);
+
+    assert!(
+        Target::from_points(&[(0.0, 1.0)])
+            .unwrap()
+            .weighted_by(&[5.0])
+            .is_err()
+    );
+}
+
+#[cfg(test)]
+#[test]
+fn parses_points_and_speeds() {
+    let points = parse_points("# speed, sens\n0, 1\n\n12.5 1.31 # fast\n").unwrap();
+    assert_eq!(points, [(0.0, 1.0), (12.5, 1.31)]);
+
+    assert!(parse_points("1, 2, 3").is_err());
+    assert!(parse_points("1, x").is_err());
+
+    assert_eq!(parse_speeds("1\n2.5\n").unwrap(), [1.0, 2.5]);
+}
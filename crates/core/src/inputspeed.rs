@@ -6,7 +6,7 @@
 
 use std::{
     fs,
-    io::Read,
+    io::{self, Read},
     thread::{self, JoinHandle},
 };
 
@@ -21,15 +21,21 @@ pub fn read_input_speed() -> f64 {
     unsafe { INPUT_SPEED }
 }
 
-pub fn setup_input_speed_reader() -> JoinHandle<anyhow::Result<()>> {
-    thread::spawn(|| {
+/// Keep reading the last input speed from /dev/maccel, calling `on_change`
+/// whenever it changes. A read blocks until the mouse moves at a new speed,
+/// so an idle mouse leaves this thread asleep.
+pub fn setup_input_speed_reader(
+    on_change: impl Fn() + Send + 'static,
+) -> JoinHandle<anyhow::Result<()>> {
+    thread::spawn(move || {
         let mut file = fs::File::open("/dev/maccel").context("failed to open /dev/maccel")?;
         let mut buffer = [0u8; 8];
 
         loop {
-            let nread = file
-                .read(&mut buffer)
-                .expect("failed to read bytes from /dev/maccel");
+            let nread = match file.read(&mut buffer) {
+                Err(err) if err.kind() == io::ErrorKind::Interrupted => continue,
+                nread => nread.expect("failed to read bytes from /dev/maccel"),
+            };
 
             let num = match nread {
                 4 => {
@@ -44,10 +50,15 @@ pub fn setup_input_speed_reader() -> JoinHandle<anyhow::Result<()>> {
 
             let num: f64 = Fpt(num).into();
 
-            // Safety don't care about race conditions
-            unsafe { INPUT_SPEED = num };
+            if num != read_input_speed() {
+                // Safety don't care about race conditions
+                unsafe { INPUT_SPEED = num };
+                on_change();
+            }
 
-            thread::sleep(std::time::Duration::from_nanos(500));
+            // While it moves, no need to read it (much) faster than it can be
+            // displayed
+            thread::sleep(std::time::Duration::from_millis(4));
         }
     })
 }
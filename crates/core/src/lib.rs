@@ -1,4 +1,7 @@
 mod context;
+pub mod dump;
+pub mod engine;
+pub mod fit;
 pub mod inputspeed;
 mod libmaccel;
 mod params;
@@ -5,6 +5,8 @@ char *fpt_to_str(fpt num);
 fpt str_to_fpt(char *string);
 double fpt_to_float(fpt value);
 fpt fpt_from_float(double value);
+void sensitivity_batch_rs(const struct accel_args *args, const double *speeds,
+                          double *sens_x, double *sens_y, size_t len);
 
 extern char *fpt_to_str(fpt num) { return fptoa(num); }
 extern fpt str_to_fpt(char *string) { return atofp(string); }
@@ -12,3 +14,21 @@ extern fpt str_to_fpt(char *string) { return atofp(string); }
 extern double fpt_to_float(fpt value) { return fpt_todouble(value); }
 
 extern fpt fpt_from_float(double value) { return fpt_rconst(value); }
+
+/*
+ * Evaluate `sensitivity()` for `len` input speeds in one call, doing the
+ * conversions from and to floats on this side, so that sweeping a curve
+ * doesn't cost three FFI calls per point. Every result is exactly what
+ * `sensitivity_rs` gives for the same speed.
+ */
+extern void sensitivity_batch_rs(const struct accel_args *args,
+                                 const double *speeds, double *sens_x,
+                                 double *sens_y, size_t len) {
+  const struct accel_args _args = *args;
+
+  for (size_t i = 0; i < len; i++) {
+    struct vector sens = sensitivity(fpt_rconst(speeds[i]), _args);
+    sens_x[i] = fpt_todouble(sens.x);
+    sens_y[i] = fpt_todouble(sens.y);
+  }
+}
@@ -78,6 +78,13 @@ mod c_libmaccel {
 
     unsafe extern "C" {
         pub fn sensitivity_rs(speed_in: fixedptc::Fpt, args: AccelParams) -> Vector;
+        pub fn sensitivity_batch_rs(
+            args: *const AccelParams,
+            speeds: *const f64,
+            sens_x: *mut f64,
+            sens_y: *mut f64,
+            len: usize,
+        );
     }
 
     unsafe extern "C" {
@@ -88,4 +95,4 @@ mod c_libmaccel {
     }
 }
 
-pub use c_libmaccel::sensitivity_rs;
+pub use c_libmaccel::{sensitivity_batch_rs, sensitivity_rs};
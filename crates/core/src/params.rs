@@ -11,7 +11,7 @@ macro_rules! declare_common_params {
         }
 
         paste!(
-            #[derive(Debug)]
+            #[derive(Debug, Clone, Copy, PartialEq)]
             pub struct AllParamArgs {
                 $( pub [< $param:snake:lower >]: Fpt ),+
             }
@@ -279,6 +279,58 @@ impl Param {
     }
 }
 
+impl Param {
+    /// The value the kernel module starts with, see `driver/params.h`
+    pub fn default_value(&self) -> f64 {
+        match self {
+            Param::SensMult => 1.0,
+            Param::YxRatio => 1.0,
+            Param::InputDpi => 1000.0,
+            Param::AngleRotation => 0.0,
+            Param::Accel => 0.0,
+            Param::OffsetLinear => 0.0,
+            Param::OutputCap => 0.0,
+            Param::DecayRate => 0.1,
+            Param::OffsetNatural => 0.0,
+            Param::Limit => 1.5,
+            Param::Gamma => 1.0,
+            Param::Smooth => 0.5,
+            Param::Motivity => 1.5,
+            Param::SyncSpeed => 5.0,
+        }
+    }
+}
+
+#[cfg(test)]
+#[test]
+fn default_values_are_the_kernel_modules() {
+    let params_h = include_str!("../../../driver/params.h");
+
+    // The 64 bits defaults come first, e.g. `PARAM(YX_RATIO, 4294967296, // 1 << 32`
+    let defaults: Vec<(&str, i64)> = params_h
+        .split("PARAM(")
+        .skip(1)
+        .filter_map(|decl| {
+            let mut fields = decl.split(',').map(str::trim);
+            Some((fields.next()?, fields.next()?.parse().ok()?))
+        })
+        .collect();
+
+    for param in ALL_PARAMS {
+        let (_, expected) = defaults
+            .iter()
+            .find(|(name, _)| *name == param.name())
+            .unwrap_or_else(|| panic!("no default for {} in params.h", param.name()));
+        assert_eq!(
+            Fpt::from(param.default_value()).0,
+            *expected,
+            "default of {}",
+            param.name()
+        );
+        validate_param_value(*param, param.default_value()).expect("a valid default");
+    }
+}
+
 pub(crate) fn format_param_value(value: f64) -> String {
     let mut number = format!("{value:.5}");
 
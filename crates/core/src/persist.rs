@@ -1,8 +1,10 @@
 use std::{
+    env,
     fmt::{Debug, Display},
     io::Read,
     path::{Path, PathBuf},
     str::FromStr,
+    sync::OnceLock,
 };
 
 use anyhow::{Context, anyhow};
@@ -10,8 +12,8 @@ use anyhow::{Context, anyhow};
 use crate::{
     fixedptc::Fpt,
     params::{
-        ALL_MODES, AccelMode, CommonParamArgs, LinearParamArgs, NaturalParamArgs, Param,
-        SynchronousParamArgs, format_param_value, validate_param_value,
+        ALL_MODES, ALL_PARAMS, AccelMode, AllParamArgs, CommonParamArgs, LinearParamArgs,
+        NaturalParamArgs, Param, SynchronousParamArgs, format_param_value, validate_param_value,
     },
 };
 
@@ -21,58 +23,28 @@ pub trait ParamStore: Debug {
 
     fn set_current_accel_mode(&mut self, mode: AccelMode) -> anyhow::Result<()>;
     fn get_current_accel_mode(&self) -> anyhow::Result<AccelMode>;
-}
-
-const SYS_MODULE_PATH: &str = "/sys/module/maccel";
 
-#[derive(Debug)]
-pub struct SysFsStore;
-
-impl ParamStore for SysFsStore {
-    fn set(&mut self, param: Param, value: f64) -> anyhow::Result<()> {
-        validate_param_value(param, value)?;
-
-        let value: Fpt = value.into();
-        let value = value.0;
-        set_parameter(param.name(), value).with_context(|| {
-            anyhow!(
-                "Failed to communicate with the driver to set parameter '{}'.",
-                param.display_name()
-            )
+    /// The values of every parameter, of every mode
+    fn get_all(&self) -> anyhow::Result<AllParamArgs> {
+        Ok(AllParamArgs {
+            sens_mult: self.get(Param::SensMult)?,
+            yx_ratio: self.get(Param::YxRatio)?,
+            input_dpi: self.get(Param::InputDpi)?,
+            angle_rotation: self.get(Param::AngleRotation)?,
+            accel: self.get(Param::Accel)?,
+            offset_linear: self.get(Param::OffsetLinear)?,
+            output_cap: self.get(Param::OutputCap)?,
+            decay_rate: self.get(Param::DecayRate)?,
+            offset_natural: self.get(Param::OffsetNatural)?,
+            limit: self.get(Param::Limit)?,
+            gamma: self.get(Param::Gamma)?,
+            smooth: self.get(Param::Smooth)?,
+            motivity: self.get(Param::Motivity)?,
+            sync_speed: self.get(Param::SyncSpeed)?,
         })
     }
 
-    fn get(&self, param: Param) -> anyhow::Result<Fpt> {
-        let value = get_paramater(param.name()).with_context(|| {
-            anyhow!(
-                "Failed to communicate with the driver to read parameter '{}'.",
-                param.display_name()
-            )
-        })?;
-        let value = Fpt::from_str(&value)
-            .with_context(|| anyhow!("couldn't interpret the parameter's value {}", value))?;
-        Ok(value)
-    }
-
-    fn set_current_accel_mode(&mut self, mode: AccelMode) -> anyhow::Result<()> {
-        set_parameter(AccelMode::PARAM_NAME, mode.ordinal())
-            .with_context(|| anyhow!("couldn't set or change the acceleration MODE."))
-    }
-    fn get_current_accel_mode(&self) -> anyhow::Result<AccelMode> {
-        get_paramater(AccelMode::PARAM_NAME)
-            .and_then(|mode_tag| -> anyhow::Result<AccelMode> {
-                let id: u8 = mode_tag
-                    .parse()
-                    .context("Failed to parse an id for mode parameter")?;
-                let idx = id as usize % ALL_MODES.len();
-                Ok(ALL_MODES[idx])
-            })
-            .with_context(|| anyhow!("couldn't read {:?} kernel parameter", AccelMode::PARAM_NAME))
-    }
-}
-
-impl SysFsStore {
-    pub fn set_all_common(&mut self, args: CommonParamArgs) -> anyhow::Result<()> {
+    fn set_all_common(&mut self, args: CommonParamArgs) -> anyhow::Result<()> {
         let CommonParamArgs {
             sens_mult,
             yx_ratio,
@@ -88,7 +60,7 @@ impl SysFsStore {
         Ok(())
     }
 
-    pub fn set_all_linear(&mut self, args: LinearParamArgs) -> anyhow::Result<()> {
+    fn set_all_linear(&mut self, args: LinearParamArgs) -> anyhow::Result<()> {
         let LinearParamArgs {
             accel,
             offset_linear,
@@ -102,7 +74,7 @@ impl SysFsStore {
         Ok(())
     }
 
-    pub fn set_all_natural(&mut self, args: NaturalParamArgs) -> anyhow::Result<()> {
+    fn set_all_natural(&mut self, args: NaturalParamArgs) -> anyhow::Result<()> {
         let NaturalParamArgs {
             decay_rate,
             limit,
@@ -116,7 +88,7 @@ impl SysFsStore {
         Ok(())
     }
 
-    pub fn set_all_synchronous(&mut self, args: SynchronousParamArgs) -> anyhow::Result<()> {
+    fn set_all_synchronous(&mut self, args: SynchronousParamArgs) -> anyhow::Result<()> {
         let SynchronousParamArgs {
             gamma,
             smooth,
@@ -133,8 +105,187 @@ impl SysFsStore {
     }
 }
 
+const SYS_MODULE_PATH: &str = "/sys/module/maccel";
+/// Points the store at a fake sysfs tree instead, with the parameters in
+/// `$MACCEL_SYSFS_ROOT/module/maccel/parameters/` (see also `FakeSysfs`)
+const SYSFS_ROOT_VAR: &str = "MACCEL_SYSFS_ROOT";
+/// Where `EngineStore` keeps the parameters, for the userspace engines
+/// (`maccel engine` and the HID-BPF loader) to read them from.
+const USERSPACE_PARAMS_PATH: &str = "/var/opt/maccel/parameters";
+
+/// The kernel module's parameters, in sysfs
+#[derive(Debug)]
+pub struct SysFsStore;
+
+impl ParamStore for SysFsStore {
+    fn set(&mut self, param: Param, value: f64) -> anyhow::Result<()> {
+        validate_param_value(param, value)?;
+
+        let value: Fpt = value.into();
+        let value = value.0;
+        set_parameter(param.name(), value).with_context(|| {
+            anyhow!(
+                "Failed to communicate with the driver to set parameter '{}'.",
+                param.display_name()
+            )
+        })
+    }
+
+    fn get(&self, param: Param) -> anyhow::Result<Fpt> {
+        let value = get_paramater(param.name()).with_context(|| {
+            anyhow!(
+                "Failed to communicate with the driver to read parameter '{}'.",
+                param.display_name()
+            )
+        })?;
+        parse_parameter(&value)
+    }
+
+    fn set_current_accel_mode(&mut self, mode: AccelMode) -> anyhow::Result<()> {
+        set_parameter(AccelMode::PARAM_NAME, mode.ordinal())
+            .with_context(|| anyhow!("couldn't set or change the acceleration MODE."))
+    }
+    fn get_current_accel_mode(&self) -> anyhow::Result<AccelMode> {
+        get_paramater(AccelMode::PARAM_NAME)
+            .and_then(|mode_tag| parse_mode(&mode_tag))
+            .with_context(|| anyhow!("couldn't read {:?} kernel parameter", AccelMode::PARAM_NAME))
+    }
+}
+
+/// The parameters of the userspace engines (`maccel engine` and the HID-BPF
+/// loader), which run instead of the kernel module. They're kept in
+/// /var/opt/maccel/parameters, where the engines pick up the changes, as
+/// decimals: unlike the module's fixed-point values, they read the same
+/// whatever the fixed-point width of the CLI that wrote them, or of the
+/// engine that reads them.
+#[derive(Debug)]
+pub struct EngineStore;
+
+impl ParamStore for EngineStore {
+    fn set(&mut self, param: Param, value: f64) -> anyhow::Result<()> {
+        validate_param_value(param, value)?;
+
+        set_engine_parameter(param.name(), value).with_context(|| {
+            anyhow!(
+                "Failed to set parameter '{}' for the userspace engine.",
+                param.display_name()
+            )
+        })
+    }
+
+    fn get(&self, param: Param) -> anyhow::Result<Fpt> {
+        let value = get_engine_parameter(param.name()).with_context(|| {
+            anyhow!(
+                "Failed to read parameter '{}' for the userspace engine.",
+                param.display_name()
+            )
+        })?;
+        let value: f64 = value
+            .parse()
+            .with_context(|| anyhow!("couldn't interpret the parameter's value {}", value))?;
+        Ok(value.into())
+    }
+
+    fn set_current_accel_mode(&mut self, mode: AccelMode) -> anyhow::Result<()> {
+        set_engine_parameter(AccelMode::PARAM_NAME, mode.ordinal()).with_context(|| {
+            anyhow!("couldn't set or change the acceleration MODE for the userspace engine.")
+        })
+    }
+    fn get_current_accel_mode(&self) -> anyhow::Result<AccelMode> {
+        get_engine_parameter(AccelMode::PARAM_NAME)
+            .and_then(|mode_tag| parse_mode(&mode_tag))
+            .with_context(|| {
+                anyhow!(
+                    "couldn't read the userspace engine's {:?} parameter",
+                    AccelMode::PARAM_NAME
+                )
+            })
+    }
+}
+
+fn parse_parameter(value: &str) -> anyhow::Result<Fpt> {
+    Fpt::from_str(value)
+        .with_context(|| anyhow!("couldn't interpret the parameter's value {}", value))
+}
+
+fn parse_mode(mode_tag: &str) -> anyhow::Result<AccelMode> {
+    let id: u8 = mode_tag
+        .parse()
+        .context("Failed to parse an id for mode parameter")?;
+    let idx = id as usize % ALL_MODES.len();
+    Ok(ALL_MODES[idx])
+}
+
+static SYS_MODULE: OnceLock<PathBuf> = OnceLock::new();
+
+/// The module's directory in sysfs, or in the fake tree of `MACCEL_SYSFS_ROOT`
+fn sys_module_path() -> &'static Path {
+    SYS_MODULE.get_or_init(|| match env::var_os(SYSFS_ROOT_VAR) {
+        Some(root) => Path::new(&root).join("module/maccel"),
+        None => PathBuf::from(SYS_MODULE_PATH),
+    })
+}
+
+/// A fake sysfs tree, with every parameter at its default, that the store
+/// reads and writes instead of the module's. It's removed when dropped.
+#[derive(Debug)]
+pub struct FakeSysfs {
+    root: PathBuf,
+}
+
+impl FakeSysfs {
+    /// Lay out the tree on a tmpfs when there's one, and point the store at
+    /// it. That has to happen before the store's first use.
+    pub fn install() -> anyhow::Result<Self> {
+        let tmp = Path::new("/dev/shm");
+        let tmp = if tmp.is_dir() {
+            tmp.to_path_buf()
+        } else {
+            env::temp_dir()
+        };
+        let fake = Self {
+            root: tmp.join(format!("maccel-sysfs-{}", std::process::id())),
+        };
+
+        let params_path = fake.root.join("module/maccel/parameters");
+        std::fs::create_dir_all(&params_path)
+            .with_context(|| anyhow!("failed to create {}", params_path.display()))?;
+
+        let names = ALL_PARAMS
+            .iter()
+            .map(|p| p.name())
+            .chain([AccelMode::PARAM_NAME]);
+        for name in names {
+            let value = default_parameter(name)
+                .with_context(|| anyhow!("no default value for parameter {:?}", name))?;
+            std::fs::write(params_path.join(name), value)
+                .with_context(|| anyhow!("failed to write the parameter {:?}", name))?;
+        }
+
+        SYS_MODULE
+            .set(fake.root.join("module/maccel"))
+            .map_err(|_| anyhow!("the parameters were already read from sysfs"))?;
+        Ok(fake)
+    }
+}
+
+impl Drop for FakeSysfs {
+    fn drop(&mut self) {
+        let _ = std::fs::remove_dir_all(&self.root);
+    }
+}
+
+fn sysfs_is_fake() -> bool {
+    sys_module_path() != Path::new(SYS_MODULE_PATH)
+}
+
+/// Whether the kernel module is loaded, the userspace engines mustn't run then
+pub fn module_is_loaded() -> bool {
+    sys_module_path().exists()
+}
+
 fn parameter_path(name: &'static str) -> anyhow::Result<PathBuf> {
-    let params_path = Path::new(SYS_MODULE_PATH).join("parameters").join(name);
+    let params_path = sys_module_path().join("parameters").join(name);
 
     if !params_path.exists() {
         return Err(anyhow!("no such path: {}", params_path.display()))
@@ -158,6 +309,17 @@ fn save_parameter_reset_script(name: &'static str, value: i64) -> anyhow::Result
     Ok(())
 }
 
+/// What the kernel module would start with, in the same (fixed-point) format
+fn default_parameter(name: &'static str) -> Option<String> {
+    if name == AccelMode::PARAM_NAME {
+        return Some(AccelMode::default().ordinal().to_string());
+    }
+    ALL_PARAMS
+        .iter()
+        .find(|p| p.name() == name)
+        .map(|p| Fpt::from(p.default_value()).0.to_string())
+}
+
 fn get_paramater(name: &'static str) -> anyhow::Result<String> {
     let path = parameter_path(name)?;
     let mut file = std::fs::File::open(&path)
@@ -185,11 +347,53 @@ fn set_parameter(name: &'static str, value: i64) -> anyhow::Result<()> {
         path.display()
     ))?;
 
-    save_parameter_reset_script(name, value)?;
+    // The reset scripts are for the real module, after a reboot
+    if !sysfs_is_fake() {
+        save_parameter_reset_script(name, value)?;
+    }
 
     Ok(())
 }
 
+fn get_engine_parameter(name: &'static str) -> anyhow::Result<String> {
+    let path = Path::new(USERSPACE_PARAMS_PATH).join(name);
+    if !path.exists() {
+        // Never set, the engines start from the module's defaults
+        return default_engine_parameter(name)
+            .with_context(|| anyhow!("no default value for parameter {:?}", name));
+    }
+    let value = std::fs::read_to_string(&path)
+        .with_context(|| anyhow!("failed to read the parameter's file: {}", path.display()))?;
+    Ok(value.trim().to_string())
+}
+
+fn default_engine_parameter(name: &'static str) -> Option<String> {
+    if name == AccelMode::PARAM_NAME {
+        return Some(AccelMode::default().ordinal().to_string());
+    }
+    ALL_PARAMS
+        .iter()
+        .find(|p| p.name() == name)
+        .map(|p| p.default_value().to_string())
+}
+
+fn set_engine_parameter(name: &'static str, value: impl Display) -> anyhow::Result<()> {
+    std::fs::create_dir_all(USERSPACE_PARAMS_PATH)
+        .with_context(|| anyhow!("failed create directory: {}", USERSPACE_PARAMS_PATH))
+        .context(
+            "failed to create the directory where we keep the userspace engine's parameters",
+        )?;
+
+    // Nothing to reset on reboot, the file itself is kept
+    let path = Path::new(USERSPACE_PARAMS_PATH).join(name);
+    std::fs::write(&path, format!("{}", value)).with_context(|| {
+        anyhow!(
+            "Failed to write to parameter file '{}'.\n-- Make sure that the user is in the maccel group \'usermod -aG maccel $USER\'.",
+            path.display()
+        )
+    })
+}
+
 impl Display for Fpt {
     fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
         f.write_str(&format_param_value(f64::from(*self)))
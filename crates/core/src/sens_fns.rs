@@ -7,7 +7,7 @@ use crate::{
 use crate::AccelMode;
 
 impl AllParamArgs {
-    fn convert_to_accel_args(&self, mode: AccelMode) -> AccelParams {
+    pub(crate) fn convert_to_accel_args(&self, mode: AccelMode) -> AccelParams {
         let params_by_mode = match mode {
             AccelMode::Linear => AccelParamsByMode::Linear(LinearCurveParams {
                 accel: self.accel,
@@ -51,3 +51,87 @@ pub fn sensitivity(s_in: f64, mode: AccelMode, params: &AllParamArgs) -> SensXY
 
     (ratio_x, ratio_y)
 }
+
+/// The sensitivity function of a mode, with its parameters converted once,
+/// for evaluating it at many input speeds without crossing the FFI boundary
+/// (and converting every result back from `Fpt`) once per speed.
+pub struct SensitivityFn {
+    args: AccelParams,
+}
+
+impl SensitivityFn {
+    pub fn new(mode: AccelMode, params: &AllParamArgs) -> Self {
+        Self {
+            args: params.convert_to_accel_args(mode),
+        }
+    }
+
+    /// Ratio of Output speed to Input speed
+    pub fn eval(&self, s_in: f64) -> SensXY {
+        let (mut ratio_x, mut ratio_y) = (0.0, 0.0);
+        self.eval_batch(
+            &[s_in],
+            std::slice::from_mut(&mut ratio_x),
+            std::slice::from_mut(&mut ratio_y),
+        );
+
+        (ratio_x, ratio_y)
+    }
+
+    /// Ratios of Output speed to Input speed, for every speed in `speeds`,
+    /// computed in a single call into the C code.
+    ///
+    /// Panics if `sens_x` or `sens_y` aren't the same length as `speeds`.
+    pub fn eval_batch(&self, speeds: &[f64], sens_x: &mut [f64], sens_y: &mut [f64]) {
+        assert_eq!(speeds.len(), sens_x.len(), "one output per speed in sens_x");
+        assert_eq!(speeds.len(), sens_y.len(), "one output per speed in sens_y");
+
+        unsafe {
+            libmaccel::sensitivity_batch_rs(
+                &self.args,
+                speeds.as_ptr(),
+                sens_x.as_mut_ptr(),
+                sens_y.as_mut_ptr(),
+                speeds.len(),
+            )
+        }
+    }
+}
+
+#[cfg(test)]
+#[test]
+fn batch_sensitivity_is_exactly_the_scalar_sensitivity() {
+    let params = AllParamArgs {
+        sens_mult: Fpt::from(1.2),
+        yx_ratio: Fpt::from(1.1),
+        input_dpi: Fpt::from(1600.0),
+        angle_rotation: Fpt::from(0.0),
+        accel: Fpt::from(0.3),
+        offset_linear: Fpt::from(2.0),
+        output_cap: Fpt::from(2.0),
+        decay_rate: Fpt::from(0.1),
+        offset_natural: Fpt::from(2.0),
+        limit: Fpt::from(1.5),
+        gamma: Fpt::from(1.0),
+        smooth: Fpt::from(0.5),
+        motivity: Fpt::from(1.5),
+        sync_speed: Fpt::from(5.0),
+    };
+
+    let speeds: Vec<f64> = (0..1024).map(|i| i as f64 * 0.125).collect();
+    let mut sens_x = vec![0.0; speeds.len()];
+    let mut sens_y = vec![0.0; speeds.len()];
+
+    for &mode in crate::ALL_MODES {
+        SensitivityFn::new(mode, &params).eval_batch(&speeds, &mut sens_x, &mut sens_y);
+
+        for (i, &speed) in speeds.iter().enumerate() {
+            let (ratio_x, ratio_y) = sensitivity(speed, mode, &params);
+            assert_eq!(
+                (sens_x[i].to_bits(), sens_y[i].to_bits()),
+                (ratio_x.to_bits(), ratio_y.to_bits()),
+                "{mode:?} at {speed} counts/ms"
+            );
+        }
+    }
+}
@@ -36,9 +36,9 @@ static char *FP_64_itoa_loop(char *buf, uint64_t scale, uint64_t value,
   return buf;
 }
 
-void FP64_ToString(FP_LONG value, char *buf);
+static void FP64_ToString(FP_LONG value, char *buf);
 
-void FP64_ToString(FP_LONG value, char *buf) {
+static void FP64_ToString(FP_LONG value, char *buf) {
   uint64_t uvalue = (value >= 0) ? value : -value;
   if (value < 0)
     *buf++ = '-';
@@ -29,7 +29,34 @@ struct accel_args {
   union __accel_args args;
 };
 
-const fpt NORMALIZED_DPI = fpt_fromint(1000);
+static const fpt NORMALIZED_DPI = fpt_fromint(1000);
+
+/**
+ * The input speed up to which the curve is flat, at a sensitivity of 1 (before
+ * the sens_mult): its offset for the linear and natural modes, and any speed
+ * when their parameters leave nothing to accelerate with. -1 when there's no
+ * such speed, as with the synchronous mode.
+ */
+static inline fpt constant_sens_speed(struct accel_args args) {
+  switch (args.tag) {
+  case linear:
+    if (args.args.linear.accel == 0) {
+      return FIXEDPT_MAX;
+    }
+    return args.args.linear.offset;
+  case natural:
+    if (args.args.natural.limit <= FIXEDPT_ONE ||
+        args.args.natural.decay_rate <= 0) {
+      return FIXEDPT_MAX;
+    }
+    return args.args.natural.offset;
+  case synchronous:
+    return -1;
+  case no_accel:
+  default:
+    return FIXEDPT_MAX;
+  }
+}
 
 /**
  * Calculate the factor by which to multiply the input vector
@@ -40,6 +67,12 @@ static inline struct vector sensitivity(fpt input_speed,
                                         struct accel_args args) {
   fpt sens;
 
+  if (input_speed <= constant_sens_speed(args)) {
+    // Pixel hunting and the like: no need to evaluate the curve
+    sens = fpt_mul(FIXEDPT_ONE, args.sens_mult);
+    return (struct vector){sens, fpt_mul(sens, args.yx_ratio)};
+  }
+
   switch (args.tag) {
   case synchronous:
     dbg("accel mode %d: synchronous", args.tag);
@@ -64,53 +97,119 @@ static inline struct vector sensitivity(fpt input_speed,
   return (struct vector){sens, fpt_mul(sens, args.yx_ratio)};
 }
 
-const fpt DEG_TO_RAD_FACTOR = fpt_xdiv(FIXEDPT_PI, fpt_rconst(180));
+/**
+ * What the input goes through before its speed is measured: the rotation by
+ * `angle_rotation_deg`, and the normalization of `input_dpi` to the
+ * NORMALIZED_DPI, as one matrix. Built when those parameters change, rather
+ * than on every frame.
+ */
+struct input_transform {
+  fpt xx, xy;
+  fpt yx, yy;
 
-static inline void f_accelerate(int *x, int *y, fpt time_interval_ms,
-                                struct accel_args args) {
-  static fpt carry_x = 0;
-  static fpt carry_y = 0;
+  /* The parameters it was built for; an input_dpi of 0 is never valid, so a
+   * zeroed transform gets built on first use */
+  fpt angle_rotation_deg;
+  fpt input_dpi;
+};
 
-  fpt dx = fpt_fromint(*x);
-  fpt dy = fpt_fromint(*y);
+static inline void build_input_transform(struct input_transform *t,
+                                         fpt angle_rotation_deg,
+                                         fpt input_dpi) {
+  fpt dpi_factor = fpt_div(NORMALIZED_DPI, input_dpi);
+  fpt sin_angle = 0;
+  fpt cos_angle = FIXEDPT_ONE;
+  if (angle_rotation_deg != 0) {
+    fpt_sincos_deg(angle_rotation_deg, &sin_angle, &cos_angle);
+  }
 
-  {
-    if (args.angle_rotation_deg == 0) {
-      goto accel_routine;
-    }
-    // Add rotation of input vector
-    fpt degrees = args.angle_rotation_deg;
-    fpt radians =
-        fpt_mul(degrees, DEG_TO_RAD_FACTOR); // Convert degrees to radians
+  dbg("rotation angle(deg):     %s deg", fptoa(angle_rotation_deg));
+  dbg("sine of rotation:        %s", fptoa(sin_angle));
+  dbg("cosine of rotation:      %s", fptoa(cos_angle));
+  dbg("dpi adjustment factor:   %s", fptoa(dpi_factor));
+
+  t->xx = fpt_mul(cos_angle, dpi_factor);
+  t->xy = -fpt_mul(sin_angle, dpi_factor);
+  t->yx = fpt_mul(sin_angle, dpi_factor);
+  t->yy = fpt_mul(cos_angle, dpi_factor);
+  t->angle_rotation_deg = angle_rotation_deg;
+  t->input_dpi = input_dpi;
+}
+
+/* A frame that comes this long after the previous one starts a new movement */
+#define IDLE_INTERVAL_MS 100
+
+/**
+ * The interval between two frames in ms, from the count of units (ns, or us
+ * for FIXEDPT_BITS=32) between them. It's capped at IDLE_INTERVAL_MS, past
+ * which any interval means the same: that way a mouse left alone for minutes
+ * doesn't overflow the fixed point.
+ */
+static inline fpt frame_interval_ms(long long units, int units_per_ms) {
+  if (units >= (long long)IDLE_INTERVAL_MS * units_per_ms) {
+    return fpt_fromint(IDLE_INTERVAL_MS);
+  }
+
+  // In two parts, as 100ms of us doesn't fit in a 16.16 fpt
+  int whole = (int)units / units_per_ms;
+  int rest = (int)units % units_per_ms;
+  return fpt_fromint(whole) +
+         fpt_div(fpt_fromint(rest), fpt_fromint(units_per_ms));
+}
 
-    fpt cos_angle = fpt_cos(radians);
-    fpt sin_angle = fpt_sin(radians);
+/**
+ * What carries over from one frame of a mouse to the next: the fractional
+ * part of the output that couldn't be reported yet, the interval between its
+ * last two frames, and the input transform.
+ */
+struct accel_state {
+  fpt carry_x;
+  fpt carry_y;
+  fpt last_interval_ms;
+  struct input_transform transform;
+};
 
-    dbg("rotation angle(deg):     %s deg", fptoa(degrees));
-    dbg("rotation angle(rad):     %s rad", fptoa(radians));
-    dbg("cosine of rotation:      %s", fptoa(cos_angle));
-    dbg("sine of rotation:        %s", fptoa(sin_angle));
+static inline void __f_accelerate(int *x, int *y, fpt time_interval_ms,
+                                  struct accel_args args,
+                                  struct accel_state *state) {
+  if (time_interval_ms >= fpt_fromint(IDLE_INTERVAL_MS)) {
+    /*
+     * The first frame after the mouse was idle: the carry of the previous
+     * movement is stale, and the idle time isn't how long this frame took
+     * to move, the polling interval is. Taking the idle time would measure
+     * a speed near 0.
+     */
+    dbg("idle for                   %s ms", fptoa(time_interval_ms));
+    state->carry_x = 0;
+    state->carry_y = 0;
+    time_interval_ms =
+        state->last_interval_ms > 0 ? state->last_interval_ms : FIXEDPT_ONE;
+  } else {
+    state->last_interval_ms = time_interval_ms;
+  }
 
-    // Rotate input vector
-    fpt dx_rot = fpt_mul(dx, cos_angle) - fpt_mul(dy, sin_angle);
-    fpt dy_rot = fpt_mul(dx, sin_angle) + fpt_mul(dy, cos_angle);
+  struct input_transform *t = &state->transform;
+  if (t->angle_rotation_deg != args.angle_rotation_deg ||
+      t->input_dpi != args.input_dpi) {
+    build_input_transform(t, args.angle_rotation_deg, args.input_dpi);
+  }
 
-    dbg("rotated x:               %s", fptoa(dx_rot));
-    dbg("rotated y:               %s", fptoa(dy_rot));
+  fpt dx = fpt_fromint(*x);
+  fpt dy = fpt_fromint(*y);
 
+  if (t->xy == 0 && t->yx == 0) {
+    dx = fpt_mul(dx, t->xx);
+    dy = fpt_mul(dy, t->yy);
+  } else {
+    fpt dx_rot = fpt_mul(dx, t->xx) + fpt_mul(dy, t->xy);
+    fpt dy_rot = fpt_mul(dx, t->yx) + fpt_mul(dy, t->yy);
     dx = dx_rot;
     dy = dy_rot;
   }
-accel_routine:
 
   dbg("in                        (%d, %d)", *x, *y);
-  dbg("in: x (fpt conversion) %s", fptoa(dx));
-  dbg("in: y (fpt conversion) %s", fptoa(dy));
-
-  fpt dpi_factor = fpt_div(NORMALIZED_DPI, args.input_dpi);
-  dbg("dpi adjustment factor:     %s", fptoa(dpi_factor));
-  dx = fpt_mul(dx, dpi_factor);
-  dy = fpt_mul(dy, dpi_factor);
+  dbg("in: x (transformed)     %s", fptoa(dx));
+  dbg("in: y (transformed)     %s", fptoa(dy));
 
   fpt speed_in = input_speed(dx, dy, time_interval_ms);
   struct vector sens = sensitivity(speed_in, args);
@@ -120,8 +219,8 @@ accel_routine:
   fpt dx_out = fpt_mul(dx, sens.x);
   fpt dy_out = fpt_mul(dy, sens.y);
 
-  dx_out = fpt_add(dx_out, carry_x);
-  dy_out = fpt_add(dy_out, carry_y);
+  dx_out = fpt_add(dx_out, state->carry_x);
+  dy_out = fpt_add(dy_out, state->carry_y);
 
   dbg("out: x                     %s", fptoa(dx_out));
   dbg("out: y                     %s", fptoa(dy_out));
@@ -131,10 +230,22 @@ accel_routine:
 
   dbg("out (int conversion)      (%d, %d)", *x, *y);
 
-  carry_x = fpt_sub(dx_out, fpt_fromint(*x));
-  carry_y = fpt_sub(dy_out, fpt_fromint(*y));
+  state->carry_x = fpt_sub(dx_out, fpt_fromint(*x));
+  state->carry_y = fpt_sub(dy_out, fpt_fromint(*y));
 
-  dbg("carry                     (%s, %s)", fptoa(carry_x), fptoa(carry_x));
+  dbg("carry                     (%s, %s)", fptoa(state->carry_x),
+      fptoa(state->carry_x));
+}
+
+/**
+ * Accelerate a frame with a single state, shared by every call: for the tests
+ * and benches that move a single mouse. See `__f_accelerate` to keep a state
+ * per mouse, as the kernel module does.
+ */
+static inline void f_accelerate(int *x, int *y, fpt time_interval_ms,
+                                struct accel_args args) {
+  static struct accel_state state = {0};
+  __f_accelerate(x, y, time_interval_ms, args, &state);
 }
 
 #endif
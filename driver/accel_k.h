@@ -8,6 +8,8 @@
 #include "linux/ktime.h"
 #include "params.h"
 #include "speed.h"
+#include <linux/atomic.h>
+#include <linux/wait.h>
 
 static struct accel_args collect_args(void) {
   struct accel_args accel = {0};
@@ -48,30 +50,73 @@ static struct accel_args collect_args(void) {
 }
 
 #if FIXEDPT_BITS == 64
-const fpt UNIT_PER_MS = fpt_rconst(1000000); // 1 million nanoseconds
+static const int UNITS_PER_MS = 1000000; // 1 million nanoseconds
 #else
-const fpt UNIT_PER_MS = fpt_rconst(1000); // 1 thousand microsends
+static const int UNITS_PER_MS = 1000; // 1 thousand microseconds
 #endif
 
-static inline void accelerate(int *x, int *y) {
+/* What the module keeps for each mouse, from one of its frames to the next */
+struct device_accel_state {
+  struct accel_state state;
+  ktime_t last_time;
+
+  /* For `maccel dump`: the interval between two frames of a movement, on
+   * average (exponentially weighted, see POLL_INTERVAL_EMA_WEIGHT) and at
+   * its shortest, and how many frames started a movement */
+  fpt mean_interval_ms;
+  fpt shortest_interval_ms;
+  u64 frames;
+  u64 resumes;
+};
+
+/*
+ * How much of the mean interval a new one replaces: 1/16, so that the mean
+ * follows a change of polling rate within about 50 frames, but not the
+ * jitter of single frames.
+ */
+#define POLL_INTERVAL_EMA_WEIGHT 16
+
+/*
+ * Bumped whenever LAST_INPUT_MOUSE_SPEED changes, waking up whoever waits on
+ * /dev/maccel for a new speed (see input_echo.h). It starts at 1 so that a
+ * file's first read, at offset 0, has something new to read.
+ */
+static atomic_long_t input_speed_seq = ATOMIC_LONG_INIT(1);
+static DECLARE_WAIT_QUEUE_HEAD(input_speed_wait);
+
+static inline void accelerate(struct device_accel_state *dev, int *x, int *y) {
   dbg("FIXEDPT_BITS = %d", FIXEDPT_BITS);
 
-  static ktime_t last_time;
   ktime_t now = ktime_get();
 
 #if FIXEDPT_BITS == 64
-  s64 unit_time = ktime_to_ns(now - last_time);
+  s64 unit_time = ktime_to_ns(now - dev->last_time);
   dbg("ktime interval -> now (%llu) vs last_ktime (%llu), diff = %llins", now,
-      last_time, unit_time);
+      dev->last_time, unit_time);
 #else
-  s64 unit_time = ktime_to_us(now - last_time);
+  s64 unit_time = ktime_to_us(now - dev->last_time);
   dbg("ktime interval -> now (%llu) vs last_ktime (%llu), diff = %llius", now,
-      last_time, unit_time);
+      dev->last_time, unit_time);
 #endif
-  last_time = now;
+  dev->last_time = now;
 
-  fpt _unit_time = fpt_fromint(unit_time);
-  fpt millisecond = fpt_div(_unit_time, UNIT_PER_MS);
+  fpt millisecond = frame_interval_ms(unit_time, UNITS_PER_MS);
+
+  dev->frames++;
+  if (millisecond >= fpt_fromint(IDLE_INTERVAL_MS)) {
+    dev->resumes++;
+  } else if (millisecond > 0) {
+    if (dev->mean_interval_ms == 0) {
+      dev->mean_interval_ms = millisecond;
+    } else {
+      dev->mean_interval_ms += (millisecond - dev->mean_interval_ms) /
+                               POLL_INTERVAL_EMA_WEIGHT;
+    }
+    if (dev->shortest_interval_ms == 0 ||
+        millisecond < dev->shortest_interval_ms) {
+      dev->shortest_interval_ms = millisecond;
+    }
+  }
 
 #if FIXEDPT_BITS == 64
   dbg("ktime interval -> converting to ns: %lluns -> %sms", unit_time,
@@ -81,7 +126,14 @@ static inline void accelerate(int *x, int *y) {
       fptoa(millisecond));
 #endif
 
-  return f_accelerate(x, y, millisecond, collect_args());
+  fpt last_speed = LAST_INPUT_MOUSE_SPEED;
+
+  __f_accelerate(x, y, millisecond, collect_args(), &dev->state);
+
+  if (LAST_INPUT_MOUSE_SPEED != last_speed) {
+    atomic_long_inc(&input_speed_seq);
+    wake_up_interruptible(&input_speed_wait);
+  }
 }
 
 #endif // !_ACCELK_H_
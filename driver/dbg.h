@@ -7,6 +7,11 @@
 #ifdef __KERNEL__
 #include <linux/printk.h>
 #define dbg(fmt, ...) dbg_k(fmt, __VA_ARGS__)
+#elif defined __bpf__
+/* Nowhere to print to from the HID-BPF program, see hid_bpf/ */
+#define dbg(fmt, ...)                                                          \
+  do {                                                                         \
+  } while (0)
 #else
 #include <stdio.h>
 #define dbg(fmt, ...) dbg_std(fmt, __VA_ARGS__)
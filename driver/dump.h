@@ -0,0 +1,153 @@
+#ifndef _DUMP_H_
+#define _DUMP_H_
+
+#include "fixedptc.h"
+
+#ifdef __KERNEL__
+#include <linux/ioctl.h>
+#include <linux/string.h>
+#else
+#include <string.h>
+#include <sys/ioctl.h>
+#endif
+
+/*
+ * A snapshot of the module's state, for diagnostics: what `maccel dump`
+ * gets from /dev/maccel in a single ioctl (see dump_k.h for its content).
+ *
+ * It describes itself, so that the CLI can decode it without knowing
+ * the module's build or version:
+ *
+ *   header:  "MACD", u8 version, u8 FIXEDPT_BITS, u16 length of the dump
+ *   records: u8 type, u8 name length, the name, then the value:
+ *     DUMP_U64, DUMP_S64  8 bytes
+ *     DUMP_FPT            8 bytes, the fpt sign extended to 64 bits
+ *     DUMP_STR            u16 length, the bytes (no NUL)
+ *     DUMP_OBJECT         the records of its fields, up to a DUMP_END
+ *     DUMP_ARRAY          its (unnamed) records, up to a DUMP_END
+ *   where a DUMP_END is just its type byte.
+ *
+ * The records at the top level make up an object. Everything is
+ * little endian.
+ */
+
+#define DUMP_MAGIC "MACD"
+#define DUMP_VERSION 1
+#define DUMP_HEADER_LEN 8
+
+/* Big enough for the module's state with MACCEL_DUMP_MAX_DEVICES mice */
+#define MACCEL_DUMP_MAX 8192
+#define MACCEL_DUMP_MAX_DEVICES 16
+
+#define MACCEL_IOCTL_DUMP _IOC(_IOC_READ, 'M', 1, MACCEL_DUMP_MAX)
+
+enum dump_type {
+  DUMP_END,
+  DUMP_U64,
+  DUMP_S64,
+  DUMP_FPT,
+  DUMP_STR,
+  DUMP_OBJECT,
+  DUMP_ARRAY,
+};
+
+struct dump_writer {
+  unsigned char *buf;
+  size_t len;
+  size_t cap;
+  /* Set when something didn't fit, the dump is then unusable */
+  int overflow;
+};
+
+static inline void dump_bytes(struct dump_writer *w, const void *src,
+                              size_t n) {
+  if (n == 0) {
+    return;
+  }
+  if (w->overflow || w->len + n > w->cap) {
+    w->overflow = 1;
+    return;
+  }
+  memcpy(w->buf + w->len, src, n);
+  w->len += n;
+}
+
+static inline void dump_le(struct dump_writer *w, unsigned long long value,
+                           int n) {
+  unsigned char bytes[8];
+  for (int i = 0; i < n; i++) {
+    bytes[i] = (value >> (i * 8)) & 0xFF;
+  }
+  dump_bytes(w, bytes, n);
+}
+
+static inline void dump_key(struct dump_writer *w, enum dump_type type,
+                            const char *name) {
+  size_t name_len = strlen(name);
+  if (name_len > 0xFF) {
+    name_len = 0xFF;
+  }
+  dump_le(w, type, 1);
+  dump_le(w, name_len, 1);
+  dump_bytes(w, name, name_len);
+}
+
+static inline void dump_begin(struct dump_writer *w, unsigned char *buf,
+                              size_t cap) {
+  *w = (struct dump_writer){.buf = buf, .cap = cap};
+  dump_bytes(w, DUMP_MAGIC, 4);
+  dump_le(w, DUMP_VERSION, 1);
+  dump_le(w, FIXEDPT_BITS, 1);
+  dump_le(w, 0, 2); // the length, once we know it
+}
+
+/* Returns the length of the dump, or -1 if it didn't fit */
+static inline long dump_end(struct dump_writer *w) {
+  if (w->overflow || w->len > 0xFFFF) {
+    return -1;
+  }
+  w->buf[6] = w->len & 0xFF;
+  w->buf[7] = (w->len >> 8) & 0xFF;
+  return w->len;
+}
+
+static inline void dump_u64(struct dump_writer *w, const char *name,
+                            unsigned long long value) {
+  dump_key(w, DUMP_U64, name);
+  dump_le(w, value, 8);
+}
+
+static inline void dump_s64(struct dump_writer *w, const char *name,
+                            long long value) {
+  dump_key(w, DUMP_S64, name);
+  dump_le(w, value, 8);
+}
+
+static inline void dump_fpt(struct dump_writer *w, const char *name,
+                            fpt value) {
+  dump_key(w, DUMP_FPT, name);
+  dump_le(w, (long long)value, 8);
+}
+
+static inline void dump_str(struct dump_writer *w, const char *name,
+                            const char *value) {
+  size_t len = value ? strlen(value) : 0;
+  if (len > 0xFFFF) {
+    len = 0xFFFF;
+  }
+  dump_key(w, DUMP_STR, name);
+  dump_le(w, len, 2);
+  dump_bytes(w, value, len);
+}
+
+/* Open an object or array, for the records up to its `dump_close` */
+static inline void dump_open(struct dump_writer *w, enum dump_type type,
+                             const char *name) {
+  dump_key(w, type, name);
+}
+
+static inline void dump_close(struct dump_writer *w) {
+  dump_le(w, DUMP_END, 1);
+}
+
+#endif // !_DUMP_H_
@@ -0,0 +1,125 @@
+#ifndef _DUMP_K_H_
+#define _DUMP_K_H_
+
+#include "accel.h"
+#include "dump.h"
+#include "input_handler.h"
+#include "params.h"
+#include "speed.h"
+#include <linux/ktime.h>
+#include <linux/utsname.h>
+
+/*
+ * What goes into the dump that /dev/maccel hands over (see dump.h for the
+ * format): how the module was built, its parameters as it reads them, its
+ * constants, and the state of each mouse.
+ *
+ * Nothing is locked against the event path, only against mice coming and
+ * going: a frame may land while we read a mouse's state.
+ */
+
+static const char *const DUMP_MODE_NAMES[] = {"linear", "natural",
+                                              "synchronous", "no_accel"};
+
+static void dump_build(struct dump_writer *w) {
+  dump_open(w, DUMP_OBJECT, "build");
+  dump_u64(w, "fixedpt_bits", FIXEDPT_BITS);
+  dump_u64(w, "debug", DEBUG_TEST);
+  // Whether rotated frames can get the axis they're missing
+  dump_u64(w, "event_injection", __cleanup_events);
+  dump_str(w, "kernel", init_utsname()->release);
+  dump_close(w);
+}
+
+static void dump_params(struct dump_writer *w) {
+  unsigned char mode = PARAM_MODE;
+
+  dump_open(w, DUMP_OBJECT, "params");
+  dump_str(w, "mode", mode < ARRAY_SIZE(DUMP_MODE_NAMES)
+                          ? DUMP_MODE_NAMES[mode]
+                          : "unknown");
+  dump_fpt(w, "sens_mult", atofp(PARAM_SENS_MULT));
+  dump_fpt(w, "yx_ratio", atofp(PARAM_YX_RATIO));
+  dump_fpt(w, "input_dpi", atofp(PARAM_INPUT_DPI));
+  dump_fpt(w, "angle_rotation", atofp(PARAM_ANGLE_ROTATION));
+  dump_fpt(w, "accel", atofp(PARAM_ACCEL));
+  dump_fpt(w, "offset", atofp(PARAM_OFFSET));
+  dump_fpt(w, "output_cap", atofp(PARAM_OUTPUT_CAP));
+  dump_fpt(w, "decay_rate", atofp(PARAM_DECAY_RATE));
+  dump_fpt(w, "limit", atofp(PARAM_LIMIT));
+  dump_fpt(w, "gamma", atofp(PARAM_GAMMA));
+  dump_fpt(w, "smooth", atofp(PARAM_SMOOTH));
+  dump_fpt(w, "motivity", atofp(PARAM_MOTIVITY));
+  dump_fpt(w, "sync_speed", atofp(PARAM_SYNC_SPEED));
+  dump_close(w);
+}
+
+static void dump_constants(struct dump_writer *w) {
+  dump_open(w, DUMP_OBJECT, "constants");
+  dump_fpt(w, "normalized_dpi", NORMALIZED_DPI);
+  dump_u64(w, "idle_interval_ms", IDLE_INTERVAL_MS);
+  dump_u64(w, "units_per_ms", UNITS_PER_MS);
+  dump_close(w);
+}
+
+static void dump_device(struct dump_writer *w, struct maccel_device *device,
+                        ktime_t now) {
+  struct input_dev *dev = device->handle.dev;
+  struct device_accel_state *accel = &device->accel;
+
+  dump_open(w, DUMP_OBJECT, "");
+  dump_str(w, "name", dev->name);
+  dump_str(w, "phys", dev->phys);
+  dump_fpt(w, "carry_x", accel->state.carry_x);
+  dump_fpt(w, "carry_y", accel->state.carry_y);
+  dump_fpt(w, "last_interval_ms", accel->state.last_interval_ms);
+  dump_fpt(w, "mean_interval_ms", accel->mean_interval_ms);
+  dump_fpt(w, "shortest_interval_ms", accel->shortest_interval_ms);
+  // While moving: slow movements skip some polls, so it can read low
+  if (accel->mean_interval_ms > 0) {
+    dump_fpt(w, "polling_rate_hz",
+             fpt_div(fpt_fromint(1000), accel->mean_interval_ms));
+  }
+  dump_s64(w, "ms_since_last_frame",
+           accel->frames ? ktime_ms_delta(now, accel->last_time) : -1);
+  dump_u64(w, "frames", accel->frames);
+  dump_u64(w, "resumes", accel->resumes);
+  dump_u64(w, "injected", device->injected);
+  dump_u64(w, "injections_dropped", device->injections_dropped);
+  dump_close(w);
+}
+
+static void dump_devices(struct dump_writer *w) {
+  struct maccel_device *device;
+  ktime_t now = ktime_get();
+  unsigned long long count = 0;
+
+  mutex_lock(&maccel_devices_lock);
+  dump_open(w, DUMP_ARRAY, "devices");
+  list_for_each_entry(device, &maccel_devices, node) {
+    if (count++ < MACCEL_DUMP_MAX_DEVICES) {
+      dump_device(w, device, now);
+    }
+  }
+  dump_close(w);
+  mutex_unlock(&maccel_devices_lock);
+
+  if (count > MACCEL_DUMP_MAX_DEVICES) {
+    dump_u64(w, "devices_omitted", count - MACCEL_DUMP_MAX_DEVICES);
+  }
+}
+
+/* Returns the length of the dump written to `buf`, or -1 if it didn't fit */
+static long write_dump(unsigned char *buf, size_t cap) {
+  struct dump_writer w;
+
+  dump_begin(&w, buf, cap);
+  dump_build(&w);
+  dump_params(&w);
+  dump_constants(&w);
+  dump_fpt(&w, "last_input_speed", LAST_INPUT_MOUSE_SPEED);
+  dump_devices(&w);
+  return dump_end(&w);
+}
+
+#endif // !_DUMP_K_H_
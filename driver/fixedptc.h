@@ -78,6 +78,12 @@
 #include <linux/math64.h>
 #include <linux/stddef.h>
 #include <linux/types.h>
+#elif defined __bpf__
+/*
+ * The HID-BPF program has the fixed width types from vmlinux.h, where
+ * int64_t is a long long: <stdint.h> would redefine it as a long.
+ */
+#include <stddef.h>
 #else
 #include <stddef.h>
 #include <stdint.h>
@@ -129,6 +135,7 @@ typedef __uint128_t fptud;
 #define FIXEDPT_TWO_PI fpt_rconst(2 * 3.14159265358979323846)
 #define FIXEDPT_HALF_PI fpt_rconst(3.14159265358979323846 / 2)
 #define FIXEDPT_E fpt_rconst(2.7182818284590452354)
+#define FIXEDPT_MAX ((fpt)(~(fptu)0 >> 1))
 
 #define fpt_abs(A) ((A) < 0 ? -(A) : (A))
 
@@ -241,7 +248,7 @@ static inline char *fptoa(const fpt A) {
   return (str);
 }
 
-static fpt atofp(char *num_string) {
+static inline fpt atofp(char *num_string) {
   fptu n = 0;
   int sign = 0;
 
@@ -286,10 +293,9 @@ static inline fpt fpt_sqrt(fpt A) {
   if (A > FIXEDPT_ONE) {
     fpt s = A;
 
-    iter = 0;
-    while (s > 0) {
+    // Bounded, for the HID-BPF verifier: s is 0 after FIXEDPT_BITS / 2 shifts
+    for (iter = 0; iter < FIXEDPT_BITS / 2 && s > 0; iter++) {
       s >>= 2;
-      iter++;
     }
   }
 
@@ -404,11 +410,10 @@ static inline fpt fpt_ln(fpt x) {
   if (x == 0)
     return 0xffffffff;
 
-  log2 = 0;
+  // Bounded, for the HID-BPF verifier: xi is 0 after FIXEDPT_BITS shifts
   xi = x;
-  while (xi > FIXEDPT_TWO) {
+  for (log2 = 0; log2 < FIXEDPT_BITS && xi > FIXEDPT_TWO; log2++) {
     xi >>= 1;
-    log2++;
   }
   f = xi - FIXEDPT_ONE;
   s = fpt_div(f, FIXEDPT_TWO + f);
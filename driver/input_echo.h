@@ -1,10 +1,12 @@
 #ifndef _INPUT_ECHO_
 #define _INPUT_ECHO_
 
+#include "dump_k.h"
 #include "fixedptc.h"
 #include "linux/cdev.h"
 #include "linux/fs.h"
 #include "speed.h"
+#include <linux/slab.h>
 #include <linux/version.h>
 
 int create_char_device(void);
@@ -36,8 +38,23 @@ static void fpt_to_int_be_bytes(fpt num, char bytes[sizeof(fpt)]) {
 #endif
 }
 
+/*
+ * Echo the last input speed, once it changed since this file's last read:
+ * the offset keeps the `input_speed_seq` that was last read, so a reader
+ * sleeps here while the mouse is idle instead of polling.
+ */
 static ssize_t read(struct file *f, char __user *user_buffer, size_t size,
                     loff_t *offset) {
+  if (atomic_long_read(&input_speed_seq) == *offset) {
+    if (f->f_flags & O_NONBLOCK)
+      return -EAGAIN;
+
+    if (wait_event_interruptible(input_speed_wait,
+                                 atomic_long_read(&input_speed_seq) != *offset))
+      return -ERESTARTSYS;
+  }
+  *offset = atomic_long_read(&input_speed_seq);
+
   dbg("echoing speed to userspace: %s", fptoa(LAST_INPUT_MOUSE_SPEED));
 
   char be_bytes_for_int[sizeof(fpt)] = {0};
@@ -51,7 +68,32 @@ static ssize_t read(struct file *f, char __user *user_buffer, size_t size,
   return sizeof(be_bytes_for_int);
 }
 
-struct file_operations fops = {.owner = THIS_MODULE, .read = read};
+/*
+ * MACCEL_IOCTL_DUMP: copy a snapshot of the module's state (see dump_k.h)
+ * into the MACCEL_DUMP_MAX bytes at `arg`, returns its length.
+ */
+static long dump_ioctl(struct file *f, unsigned int cmd, unsigned long arg) {
+  if (cmd != MACCEL_IOCTL_DUMP)
+    return -ENOTTY;
+
+  unsigned char *buf = kzalloc(MACCEL_DUMP_MAX, GFP_KERNEL);
+  if (!buf)
+    return -ENOMEM;
+
+  long len = write_dump(buf, MACCEL_DUMP_MAX);
+  if (len < 0)
+    len = -ENOSPC;
+  else if (copy_to_user((void __user *)arg, buf, len))
+    len = -EFAULT;
+
+  kfree(buf);
+  return len;
+}
+
+struct file_operations fops = {.owner = THIS_MODULE,
+                               .read = read,
+                               .unlocked_ioctl = dump_ioctl,
+                               .compat_ioctl = compat_ptr_ioctl};
 
 int create_char_device(void) {
   int err;
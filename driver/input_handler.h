@@ -1,7 +1,12 @@
+#ifndef _INPUT_HANDLER_H_
+#define _INPUT_HANDLER_H_
+
 #include "./accel_k.h"
 #include "linux/input.h"
 #include "mouse_move.h"
 #include <linux/hid.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
 #include <linux/version.h>
 
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(6, 11, 0))
@@ -10,10 +15,25 @@
 #define __cleanup_events 1
 #endif
 
-static inline bool rotation_is_enabled(void) {
-  /* Fast check: the default is "0", so skip atofp unless the string differs */
-  return PARAM_ANGLE_ROTATION[0] != '0' || PARAM_ANGLE_ROTATION[1] != '\0';
-}
+/* A mouse we're connected to */
+struct maccel_device {
+  struct input_handle handle;
+  struct device_accel_state accel;
+  /* The frame being collected, from the batch being handled */
+  mouse_move movement;
+
+  /* The synthetic events of rotated frames: injected, or left out for
+   * lack of room in the batch */
+  u64 injected;
+  u64 injections_dropped;
+
+  /* In `maccel_devices` */
+  struct list_head node;
+};
+
+/* Every mouse we're connected to, for `maccel dump` */
+static LIST_HEAD(maccel_devices);
+static DEFINE_MUTEX(maccel_devices_lock);
 
 /*
  * Collect the events EV_REL REL_X and EV_REL REL_Y, once we have both then
@@ -22,41 +42,45 @@ static inline bool rotation_is_enabled(void) {
  */
 static void event(struct input_handle *handle, struct input_value *value_ptr) {
   /* printk(KERN_INFO "type %d, code %d, value %d", type, code, value); */
+  struct maccel_device *device =
+      container_of(handle, struct maccel_device, handle);
+  mouse_move *movement = &device->movement;
 
   switch (value_ptr->type) {
   case EV_REL: {
     dbg("EV_REL => code %d, value %d", value_ptr->code, value_ptr->value);
-    update_mouse_move(value_ptr);
+    update_mouse_move(movement, value_ptr);
     return;
   }
   case EV_SYN: {
-    int x = get_x(MOVEMENT);
-    int y = get_y(MOVEMENT);
+    int x = get_x(movement);
+    int y = get_y(movement);
+    clear_injections(movement);
     if (x || y) {
       dbg("EV_SYN => code %d", value_ptr->code);
 
       /*
-       * When rotation is active and one axis is missing from this frame,
-       * point the missing axis to synthetic storage so f_accelerate can
-       * write the rotated cross-axis component into it. The synthetic
-       * value is later injected into the event stream by maccel_events().
+       * When one axis is missing from this frame, point it to synthetic
+       * storage so f_accelerate can write the rotated cross-axis component
+       * into it. The synthetic value is later injected into the event
+       * stream by maccel_events(), unless it's 0: as it always is without
+       * rotation, the carry being less than a count. So there's no need to
+       * check the parameter on every frame.
        *
        * Only on >= 6.11.0: injection into the event buffer is not
        * possible on older kernels, so there is no point in computing
        * the cross-axis component.
        */
 #if __cleanup_events
-      if (rotation_is_enabled()) {
-        ensure_axes_for_rotation();
-      }
+      ensure_axes_for_rotation(movement);
 #endif
 
-      accelerate(&x, &y);
+      accelerate(&device->accel, &x, &y);
       dbg("accelerated -> (%d, %d)", x, y);
-      set_x_move(x);
-      set_y_move(y);
+      set_x_move(movement, x);
+      set_y_move(movement, y);
 
-      clear_mouse_move();
+      clear_mouse_move(movement);
     }
 
     return;
@@ -104,8 +128,15 @@ static void maccel_events(struct input_handle *handle,
    * behavior — the kernel won't deliver them and may behave erratically.
    */
   {
+    struct maccel_device *device =
+        container_of(handle, struct maccel_device, handle);
+    const mouse_move *movement = &device->movement;
     struct input_value *syn_pos = NULL;
     unsigned int max = handle->dev->max_vals;
+    bool inject_x = movement->injected_x &&
+                    movement->synthetic_x_val != NONE_EVENT_VALUE;
+    bool inject_y = movement->injected_y &&
+                    movement->synthetic_y_val != NONE_EVENT_VALUE;
 
     /* Find the last SYN_REPORT so we can insert before it */
     for (v = vals; v != end; v++) {
@@ -113,30 +144,38 @@ static void maccel_events(struct input_handle *handle,
         syn_pos = v;
     }
 
-    if (injected_x && synthetic_x_val != NONE_EVENT_VALUE && _count < max) {
+    if (inject_x && _count < max) {
       if (syn_pos) {
         /* Shift SYN_REPORT and everything after it forward by one */
         memmove(syn_pos + 1, syn_pos, (end - syn_pos) * sizeof(*syn_pos));
         syn_pos->type = EV_REL;
         syn_pos->code = REL_X;
-        syn_pos->value = synthetic_x_val;
+        syn_pos->value = movement->synthetic_x_val;
         syn_pos++;
         end++;
         _count++;
+        device->injected++;
       }
-      dbg("rotation: injected synthetic REL_X = %d", synthetic_x_val);
+      dbg("rotation: injected synthetic REL_X = %d",
+          movement->synthetic_x_val);
+    } else if (inject_x) {
+      device->injections_dropped++;
     }
 
-    if (injected_y && synthetic_y_val != NONE_EVENT_VALUE && _count < max) {
+    if (inject_y && _count < max) {
       if (syn_pos) {
         memmove(syn_pos + 1, syn_pos, (end - syn_pos) * sizeof(*syn_pos));
         syn_pos->type = EV_REL;
         syn_pos->code = REL_Y;
-        syn_pos->value = synthetic_y_val;
+        syn_pos->value = movement->synthetic_y_val;
         end++;
         _count++;
+        device->injected++;
       }
-      dbg("rotation: injected synthetic REL_Y = %d", synthetic_y_val);
+      dbg("rotation: injected synthetic REL_Y = %d",
+          movement->synthetic_y_val);
+    } else if (inject_y) {
+      device->injections_dropped++;
     }
   }
 #endif
@@ -175,12 +214,14 @@ static int input_register_handle_head(struct input_handle *handle) {
 
 static int maccel_connect(struct input_handler *handler, struct input_dev *dev,
                           const struct input_device_id *id) {
+  struct maccel_device *device;
   struct input_handle *handle;
   int error;
 
-  handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
-  if (!handle)
+  device = kzalloc(sizeof(struct maccel_device), GFP_KERNEL);
+  if (!device)
     return -ENOMEM;
+  handle = &device->handle;
 
   handle->dev = input_get_device(dev);
   handle->handler = handler;
@@ -194,6 +235,10 @@ static int maccel_connect(struct input_handler *handler, struct input_dev *dev,
   if (error)
     goto err_unregister_handle;
 
+  mutex_lock(&maccel_devices_lock);
+  list_add_tail(&device->node, &maccel_devices);
+  mutex_unlock(&maccel_devices_lock);
+
   printk(KERN_INFO pr_fmt("maccel flags: DEBUG=%s; FIXEDPT_BITS=%d"),
          DEBUG_TEST ? "true" : "false", FIXEDPT_BITS);
 
@@ -206,14 +251,21 @@ err_unregister_handle:
   input_unregister_handle(handle);
 
 err_free_mem:
-  kfree(handle);
+  kfree(device);
   return error;
 }
 
 static void maccel_disconnect(struct input_handle *handle) {
+  struct maccel_device *device =
+      container_of(handle, struct maccel_device, handle);
+
+  mutex_lock(&maccel_devices_lock);
+  list_del(&device->node);
+  mutex_unlock(&maccel_devices_lock);
+
   input_close_device(handle);
   input_unregister_handle(handle);
-  kfree(handle);
+  kfree(device);
 }
 
 static const struct input_device_id my_ids[] = {
@@ -229,3 +281,5 @@ struct input_handler maccel_handler = {.events = maccel_events,
                                        .disconnect = maccel_disconnect,
                                        .name = "maccel",
                                        .id_table = my_ids};
+
+#endif // !_INPUT_HANDLER_H_
@@ -4,32 +4,36 @@
 
 #define NONE_EVENT_VALUE 0
 
+/*
+ * Where the REL_X and REL_Y of the frame being collected are, in the batch
+ * of events. One per mouse, in its `struct maccel_device`.
+ */
 typedef struct {
   int *x;
   int *y;
-} mouse_move;
 
-static mouse_move MOVEMENT = {.x = NULL, .y = NULL};
-
-/*
- * Track whether we injected synthetic storage for a missing axis.
- * When rotation is active and the mouse only reports one axis (e.g. pure
- * horizontal movement -> only REL_X), we need a place for f_accelerate
- * to write the rotated cross-axis component. These synthetic values
- * are later injected into the event stream by maccel_events().
- */
-static bool injected_x = false;
-static bool injected_y = false;
-static int synthetic_x_val = 0;
-static int synthetic_y_val = 0;
+  /*
+   * Track whether we injected synthetic storage for a missing axis.
+   * When rotation is active and the mouse only reports one axis (e.g. pure
+   * horizontal movement -> only REL_X), we need a place for f_accelerate
+   * to write the rotated cross-axis component. These synthetic values
+   * are later injected into the event stream by maccel_events(), so they
+   * stay set until the next frame.
+   */
+  bool injected_x;
+  bool injected_y;
+  int synthetic_x_val;
+  int synthetic_y_val;
+} mouse_move;
 
-static inline void update_mouse_move(struct input_value *value) {
+static inline void update_mouse_move(mouse_move *movement,
+                                     struct input_value *value) {
   switch (value->code) {
   case REL_X:
-    MOVEMENT.x = &value->value;
+    movement->x = &value->value;
     break;
   case REL_Y:
-    MOVEMENT.y = &value->value;
+    movement->y = &value->value;
     break;
   default:
     dbg("bad movement input_value: (code, value) = (%d, %d)", value->code,
@@ -37,32 +41,32 @@ static inline void update_mouse_move(struct input_value *value) {
   }
 }
 
-static inline int get_x(mouse_move movement) {
-  if (movement.x == NULL) {
+static inline int get_x(const mouse_move *movement) {
+  if (movement->x == NULL) {
     return NONE_EVENT_VALUE;
   }
-  return *movement.x;
+  return *movement->x;
 }
 
-static inline int get_y(mouse_move movement) {
-  if (movement.y == NULL) {
+static inline int get_y(const mouse_move *movement) {
+  if (movement->y == NULL) {
     return NONE_EVENT_VALUE;
   }
-  return *movement.y;
+  return *movement->y;
 }
 
-static inline void set_x_move(int value) {
-  if (MOVEMENT.x == NULL) {
+static inline void set_x_move(mouse_move *movement, int value) {
+  if (movement->x == NULL) {
     return;
   }
-  *MOVEMENT.x = value;
+  *movement->x = value;
 }
 
-static inline void set_y_move(int value) {
-  if (MOVEMENT.y == NULL) {
+static inline void set_y_move(mouse_move *movement, int value) {
+  if (movement->y == NULL) {
     return;
   }
-  *MOVEMENT.y = value;
+  *movement->y = value;
 }
 
 /*
@@ -70,24 +74,29 @@ static inline void set_y_move(int value) {
  * point the missing axis to synthetic storage so f_accelerate can
  * write the rotated component into it.
  */
-static inline void ensure_axes_for_rotation(void) {
-  if (MOVEMENT.x == NULL) {
-    synthetic_x_val = 0;
-    MOVEMENT.x = &synthetic_x_val;
-    injected_x = true;
+static inline void ensure_axes_for_rotation(mouse_move *movement) {
+  if (movement->x == NULL) {
+    movement->synthetic_x_val = 0;
+    movement->x = &movement->synthetic_x_val;
+    movement->injected_x = true;
     dbg("rotation: injecting synthetic REL_X storage (x=%d)", 0);
   }
-  if (MOVEMENT.y == NULL) {
-    synthetic_y_val = 0;
-    MOVEMENT.y = &synthetic_y_val;
-    injected_y = true;
+  if (movement->y == NULL) {
+    movement->synthetic_y_val = 0;
+    movement->y = &movement->synthetic_y_val;
+    movement->injected_y = true;
     dbg("rotation: injecting synthetic REL_Y storage (y=%d)", 0);
   }
 }
 
-static inline void clear_mouse_move(void) {
-  MOVEMENT.x = NULL;
-  MOVEMENT.y = NULL;
-  injected_x = false;
-  injected_y = false;
+/* A new frame starts, nothing of the last one is to be injected anymore */
+static inline void clear_injections(mouse_move *movement) {
+  movement->injected_x = false;
+  movement->injected_y = false;
+}
+
+/* The frame was accelerated, its events may move in the batch from now on */
+static inline void clear_mouse_move(mouse_move *movement) {
+  movement->x = NULL;
+  movement->y = NULL;
 }
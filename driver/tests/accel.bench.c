@@ -0,0 +1,193 @@
+#include "../accel.h"
+#include "bench_utils.h"
+#include <stdio.h>
+
+/*
+ * Microbenchmarks of the per-frame acceleration path: `sensitivity()` and
+ * `f_accelerate()` for every mode, with and without rotation, over a few
+ * input speed distributions.
+ *
+ * Usage: accel_bench [results.csv] [name filter]
+ */
+
+struct speed_distribution {
+  const char *name;
+  /* counts/ms, and the share of the inputs, of each (log-normal) component */
+  double medians[3];
+  double weights[3];
+};
+
+static const struct speed_distribution DISTRIBUTIONS[] = {
+    /* pixel hunting, mostly one-count frames */
+    {"slow", {1.5, 0, 0}, {1, 0, 0}},
+    {"medium", {12, 0, 0}, {1, 0, 0}},
+    /* flicks */
+    {"fast", {60, 0, 0}, {1, 0, 0}},
+    /* a rough guess of what a gaming session looks like */
+    {"mixed", {1.5, 12, 60}, {0.6, 0.3, 0.1}},
+};
+
+#define DISTRIBUTIONS_LEN (sizeof(DISTRIBUTIONS) / sizeof(DISTRIBUTIONS[0]))
+
+struct bench_inputs {
+  int x[BENCH_INPUTS];
+  int y[BENCH_INPUTS];
+  fpt interval[BENCH_INPUTS];
+  fpt speed[BENCH_INPUTS];
+};
+
+static void generate_inputs(struct bench_inputs *in,
+                            const struct speed_distribution *dist) {
+  bench_rng_state = 0x9E3779B97F4A7C15ull;
+
+  for (int i = 0; i < BENCH_INPUTS; i++) {
+    double pick = bench_rand_unit();
+    int c = 0;
+    while (c < 2 && pick > dist->weights[c]) {
+      pick -= dist->weights[c];
+      c++;
+    }
+
+    double speed = bench_rand_lognormal(dist->medians[c], 0.5);
+    /* 1000Hz polling, with some jitter */
+    double interval = 1.0 + (bench_rand_unit() - 0.5) * 0.1;
+    double angle = bench_rand_unit() * 2 * M_PI;
+    double distance = speed * interval;
+
+    int x = (int)lround(distance * cos(angle));
+    int y = (int)lround(distance * sin(angle));
+    if (x == 0 && y == 0) {
+      x = 1;
+    }
+
+    in->x[i] = x;
+    in->y[i] = y;
+    in->interval[i] = fpt_rconst(interval);
+    in->speed[i] = fpt_rconst(speed);
+  }
+}
+
+struct bench_ctx {
+  struct bench_inputs *inputs;
+  struct accel_args args;
+  int idx;
+};
+
+static void bench_sensitivity(void *_ctx, int batch) {
+  struct bench_ctx *ctx = _ctx;
+  int64_t acc = 0;
+  for (int i = 0; i < batch; i++) {
+    int idx = ctx->idx++ & BENCH_INPUTS_MASK;
+    struct vector sens = sensitivity(ctx->inputs->speed[idx], ctx->args);
+    acc += sens.x + sens.y;
+  }
+  bench_sink = acc;
+}
+
+static void bench_f_accelerate(void *_ctx, int batch) {
+  struct bench_ctx *ctx = _ctx;
+  int64_t acc = 0;
+  for (int i = 0; i < batch; i++) {
+    int idx = ctx->idx++ & BENCH_INPUTS_MASK;
+    int x = ctx->inputs->x[idx];
+    int y = ctx->inputs->y[idx];
+    f_accelerate(&x, &y, ctx->inputs->interval[idx], ctx->args);
+    acc += x + y;
+  }
+  bench_sink = acc;
+}
+
+static struct accel_args args_for_mode(enum accel_mode mode) {
+  struct accel_args args = {
+      .sens_mult = FIXEDPT_ONE,
+      .yx_ratio = FIXEDPT_ONE,
+      .input_dpi = fpt_fromint(1000),
+      .tag = mode,
+  };
+
+  switch (mode) {
+  case linear:
+    args.args.linear = (struct linear_curve_args){
+        .accel = fpt_rconst(0.3),
+        .offset = fpt_rconst(2),
+        .output_cap = fpt_rconst(2),
+    };
+    break;
+  case natural:
+    args.args.natural = (struct natural_curve_args){
+        .decay_rate = fpt_rconst(0.1),
+        .offset = fpt_rconst(2),
+        .limit = fpt_rconst(1.5),
+    };
+    break;
+  case synchronous:
+    args.args.synchronous = (struct synchronous_curve_args){
+        .gamma = fpt_rconst(0.8),
+        .smooth = fpt_rconst(0.5),
+        .motivity = fpt_rconst(1.5),
+        .sync_speed = fpt_rconst(32),
+    };
+    break;
+  case no_accel:
+  default:
+    break;
+  }
+
+  return args;
+}
+
+static const char *MODE_NAMES[] = {"linear", "natural", "synchronous",
+                                   "no_accel"};
+
+static int matches(const char *name, const char *filter) {
+  return filter == NULL || strstr(name, filter) != NULL;
+}
+
+int main(int argc, char **argv) {
+  FILE *csv = NULL;
+  if (argc > 1) {
+    csv = fopen(argv[1], "a");
+    if (csv == NULL) {
+      perror("failed to open the benchmark results file");
+      return 1;
+    }
+  }
+  const char *filter = argc > 2 && argv[2][0] != '\0' ? argv[2] : NULL;
+
+  static struct bench_inputs inputs;
+  char name[128];
+
+  printf("[%s]\t\tFIXEDPT_BITS=%d\n", __FILE_NAME__, FIXEDPT_BITS);
+
+  for (size_t d = 0; d < DISTRIBUTIONS_LEN; d++) {
+    const struct speed_distribution *dist = &DISTRIBUTIONS[d];
+    generate_inputs(&inputs, dist);
+
+    for (int mode = linear; mode <= no_accel; mode++) {
+      struct bench_ctx ctx = {.inputs = &inputs, .args = args_for_mode(mode)};
+
+      sprintf(name, "sensitivity/%s/%s", MODE_NAMES[mode], dist->name);
+      if (matches(name, filter)) {
+        bench_report(csv, name, bench_run(bench_sensitivity, &ctx));
+      }
+
+      sprintf(name, "f_accelerate/%s/%s", MODE_NAMES[mode], dist->name);
+      if (matches(name, filter)) {
+        bench_report(csv, name, bench_run(bench_f_accelerate, &ctx));
+      }
+
+      ctx.args.angle_rotation_deg = fpt_rconst(15);
+      sprintf(name, "f_accelerate/%s/rotation/%s", MODE_NAMES[mode],
+              dist->name);
+      if (matches(name, filter)) {
+        bench_report(csv, name, bench_run(bench_f_accelerate, &ctx));
+      }
+    }
+  }
+
+  if (csv != NULL) {
+    fclose(csv);
+  }
+
+  return 0;
+}
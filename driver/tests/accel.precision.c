@@ -0,0 +1,577 @@
+#include "../accel.h"
+#include <math.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Measure how far the fixed-point curves (and the math primitives they are
+ * built on) drift from their mathematical definition, by evaluating them
+ * over dense parameter and input grids and comparing against the same
+ * formulas in double precision.
+ *
+ * Inputs and parameters are quantized to fpt first, and the reference is
+ * evaluated at the quantized values, so that the errors are those of the
+ * arithmetic only.
+ *
+ * Usage: accel_precision map.csv worst.csv [name filter]
+ *
+ * map.csv gets one row per function and combination of parameters, with its
+ * error statistics over all inputs; worst.csv the worst points of every
+ * function. Points where the fixed-point math traps (e.g. a quotient that
+ * overflows the 128/64-bit division) are counted as `traps`.
+ */
+
+#define MAX_PARAMS 4
+#define MAX_GRID 8
+
+#define INPUT_POINTS 256
+/* Extra inputs within +-10% of a knee of the curve, e.g. the offset */
+#define KNEE_POINTS 32
+#define WORST_LEN 10
+
+struct precision_fn {
+  const char *name;
+  const char *param_names[MAX_PARAMS];
+  double grid[MAX_PARAMS][MAX_GRID];
+  int grid_len[MAX_PARAMS];
+  /* index of the parameter at which the curve bends, or -1 */
+  int knee;
+  double input_min;
+  double input_max;
+  int log_spaced;
+
+  fpt (*fixed)(const fpt *params, fpt x);
+  double (*reference)(const double *params, double x);
+};
+
+struct point_error {
+  double input;
+  double reference;
+  double value;
+  double abs_err;
+  double rel_err;
+  char params[96];
+};
+
+/* ---- the curves, through `sensitivity()`, and their double references ---- */
+
+static struct accel_args curve_args(enum accel_mode mode) {
+  return (struct accel_args){
+      .sens_mult = FIXEDPT_ONE,
+      .yx_ratio = FIXEDPT_ONE,
+      .input_dpi = fpt_fromint(1000),
+      .tag = mode,
+  };
+}
+
+static fpt linear_fixed(const fpt *p, fpt x) {
+  struct accel_args args = curve_args(linear);
+  args.args.linear = (struct linear_curve_args){p[0], p[1], p[2]};
+  return sensitivity(x, args).x;
+}
+
+static double linear_reference(const double *p, double x) {
+  double accel = p[0], offset = p[1], output_cap = p[2];
+  if (x <= offset) {
+    return 1;
+  }
+
+  double sens = accel * (x - offset) * (x - offset) / x;
+  double sign = 1;
+  if (output_cap > 0) {
+    double cap = output_cap - 1;
+    if (cap < 0) {
+      cap = -cap;
+      sign = -1;
+    }
+    sens = fmin(sens, cap);
+  }
+  return 1 + sign * sens;
+}
+
+static fpt natural_fixed(const fpt *p, fpt x) {
+  struct accel_args args = curve_args(natural);
+  args.args.natural = (struct natural_curve_args){p[0], p[1], p[2]};
+  return sensitivity(x, args).x;
+}
+
+static double natural_reference(const double *p, double x) {
+  double decay_rate = p[0], offset = p[1], limit = p[2];
+  if (x <= offset || limit <= 1 || decay_rate <= 0) {
+    return 1;
+  }
+
+  double l = limit - 1;
+  double accel = decay_rate / fabs(l);
+  double constant = -l / accel;
+  double offset_x = offset - x;
+  double decay = exp(accel * offset_x);
+  double output = l * (decay / accel - offset_x) + constant;
+  return output / x + 1;
+}
+
+static fpt synchronous_fixed(const fpt *p, fpt x) {
+  struct accel_args args = curve_args(synchronous);
+  args.args.synchronous =
+      (struct synchronous_curve_args){p[0], p[1], p[2], p[3]};
+  return sensitivity(x, args).x;
+}
+
+static double synchronous_reference(const double *p, double x) {
+  double gamma = p[0], smooth = p[1], motivity = p[2], sync_speed = p[3];
+  double log_motivity = log(motivity);
+  double gamma_const = gamma / log_motivity;
+  double sharpness = smooth == 0 ? 16 : 0.5 / smooth;
+
+  if (sharpness >= 16) {
+    double log_space = gamma_const * (log(x) - log(sync_speed));
+    if (log_space < -1) {
+      return 1 / motivity;
+    }
+    if (log_space > 1) {
+      return motivity;
+    }
+    return exp(log_space * log_motivity);
+  }
+
+  if (x == sync_speed) {
+    return 1;
+  }
+
+  double log_diff = log(x) - log(sync_speed);
+  double sign = log_diff > 0 ? 1 : -1;
+  double log_space = gamma_const * fabs(log_diff);
+  double exponent = sign * pow(tanh(pow(log_space, sharpness)), 1 / sharpness);
+  return exp(exponent * log_motivity);
+}
+
+/* ---- the primitives of fixedptc.h ---- */
+
+static fpt exp_fixed(const fpt *p, fpt x) {
+  (void)p;
+  return fpt_exp(x);
+}
+static double exp_reference(const double *p, double x) {
+  (void)p;
+  return exp(x);
+}
+
+static fpt ln_fixed(const fpt *p, fpt x) {
+  (void)p;
+  return fpt_ln(x);
+}
+static double ln_reference(const double *p, double x) {
+  (void)p;
+  return log(x);
+}
+
+static fpt sqrt_fixed(const fpt *p, fpt x) {
+  (void)p;
+  return fpt_sqrt(x);
+}
+static double sqrt_reference(const double *p, double x) {
+  (void)p;
+  return sqrt(x);
+}
+
+static fpt tanh_fixed(const fpt *p, fpt x) {
+  (void)p;
+  return fpt_tanh(x);
+}
+static double tanh_reference(const double *p, double x) {
+  (void)p;
+  return tanh(x);
+}
+
+static fpt pow_fixed(const fpt *p, fpt x) { return fpt_pow(x, p[0]); }
+static double pow_reference(const double *p, double x) { return pow(x, p[0]); }
+
+static fpt sin_fixed(const fpt *p, fpt x) {
+  (void)p;
+  return fpt_sin(x);
+}
+static double sin_reference(const double *p, double x) {
+  (void)p;
+  return sin(x);
+}
+
+static fpt cos_fixed(const fpt *p, fpt x) {
+  (void)p;
+  return fpt_cos(x);
+}
+static double cos_reference(const double *p, double x) {
+  (void)p;
+  return cos(x);
+}
+
+/* The rotation's, in degrees */
+static fpt sin_deg_fixed(const fpt *p, fpt x) {
+  (void)p;
+  fpt sin_angle, cos_angle;
+  fpt_sincos_deg(x, &sin_angle, &cos_angle);
+  return sin_angle;
+}
+static double sin_deg_reference(const double *p, double x) {
+  (void)p;
+  return sin(x * M_PI / 180);
+}
+
+static fpt cos_deg_fixed(const fpt *p, fpt x) {
+  (void)p;
+  fpt sin_angle, cos_angle;
+  fpt_sincos_deg(x, &sin_angle, &cos_angle);
+  return cos_angle;
+}
+static double cos_deg_reference(const double *p, double x) {
+  (void)p;
+  return cos(x * M_PI / 180);
+}
+
+/* Speeds are in counts/ms, at the normalized DPI */
+#define SPEED_MIN 0.01
+#define SPEED_MAX 500
+
+static const struct precision_fn FUNCTIONS[] = {
+    {
+        .name = "linear",
+        .param_names = {"accel", "offset", "output_cap"},
+        .grid = {{0.001, 0.01, 0.05, 0.1, 0.3, 1},
+                 {0, 2, 5, 10, 20},
+                 {0, 0.5, 1.5, 2, 4}},
+        .grid_len = {6, 5, 5},
+        .knee = 1,
+        .input_min = SPEED_MIN,
+        .input_max = SPEED_MAX,
+        .log_spaced = 1,
+        .fixed = linear_fixed,
+        .reference = linear_reference,
+    },
+    {
+        .name = "natural",
+        .param_names = {"decay_rate", "offset", "limit"},
+        .grid = {{0.01, 0.05, 0.1, 0.3, 1},
+                 {0, 2, 5, 10, 20},
+                 {1.1, 1.5, 2, 4, 8}},
+        .grid_len = {5, 5, 5},
+        .knee = 1,
+        .input_min = SPEED_MIN,
+        .input_max = SPEED_MAX,
+        .log_spaced = 1,
+        .fixed = natural_fixed,
+        .reference = natural_reference,
+    },
+    {
+        .name = "synchronous",
+        .param_names = {"gamma", "smooth", "motivity", "sync_speed"},
+        .grid = {{0.25, 0.5, 1, 2, 4, 8, 16, 32},
+                 {0, 0.1, 0.25, 0.5, 1},
+                 {1.1, 1.5, 2, 4},
+                 {1, 5, 15, 40}},
+        .grid_len = {8, 5, 4, 4},
+        .knee = 3,
+        .input_min = SPEED_MIN,
+        .input_max = SPEED_MAX,
+        .log_spaced = 1,
+        .fixed = synchronous_fixed,
+        .reference = synchronous_reference,
+    },
+    {
+        .name = "fpt_exp",
+        .knee = -1,
+        .input_min = -10,
+        .input_max = 10,
+        .fixed = exp_fixed,
+        .reference = exp_reference,
+    },
+    {
+        .name = "fpt_ln",
+        .knee = -1,
+        .input_min = 0.001,
+        .input_max = 30000,
+        .log_spaced = 1,
+        .fixed = ln_fixed,
+        .reference = ln_reference,
+    },
+    {
+        .name = "fpt_sqrt",
+        .knee = -1,
+        .input_min = 0.001,
+        .input_max = 30000,
+        .log_spaced = 1,
+        .fixed = sqrt_fixed,
+        .reference = sqrt_reference,
+    },
+    {
+        .name = "fpt_tanh",
+        .knee = -1,
+        .input_min = -8,
+        .input_max = 8,
+        .fixed = tanh_fixed,
+        .reference = tanh_reference,
+    },
+    {
+        .name = "fpt_pow",
+        .param_names = {"exp"},
+        .grid = {{-3, -1.5, -0.5, 0.25, 0.5, 1.5, 2, 3}},
+        .grid_len = {8},
+        .knee = -1,
+        .input_min = 0.05,
+        .input_max = 20,
+        .log_spaced = 1,
+        .fixed = pow_fixed,
+        .reference = pow_reference,
+    },
+    {
+        .name = "fpt_sin",
+        .knee = -1,
+        .input_min = -2 * M_PI,
+        .input_max = 2 * M_PI,
+        .fixed = sin_fixed,
+        .reference = sin_reference,
+    },
+    {
+        .name = "fpt_cos",
+        .knee = -1,
+        .input_min = -2 * M_PI,
+        .input_max = 2 * M_PI,
+        .fixed = cos_fixed,
+        .reference = cos_reference,
+    },
+    {
+        .name = "sincos_deg sin",
+        .knee = -1,
+        .input_min = -360,
+        .input_max = 360,
+        .fixed = sin_deg_fixed,
+        .reference = sin_deg_reference,
+    },
+    {
+        .name = "sincos_deg cos",
+        .knee = -1,
+        .input_min = -360,
+        .input_max = 360,
+        .fixed = cos_deg_fixed,
+        .reference = cos_deg_reference,
+    },
+};
+
+#define FUNCTIONS_LEN (sizeof(FUNCTIONS) / sizeof(FUNCTIONS[0]))
+
+/* ---- evaluation ---- */
+
+static sigjmp_buf trap_env;
+
+static void on_trap(int sig) {
+  (void)sig;
+  siglongjmp(trap_env, 1);
+}
+
+/* Evaluate the fixed-point function, returns 0 if it trapped */
+static int eval_fixed(const struct precision_fn *fn, const fpt *params, fpt x,
+                      fpt *out) {
+  if (sigsetjmp(trap_env, 1)) {
+    return 0;
+  }
+  *out = fn->fixed(params, x);
+  return 1;
+}
+
+static int input_grid(const struct precision_fn *fn, const double *params,
+                      double *inputs) {
+  int n = 0;
+  for (int i = 0; i < INPUT_POINTS; i++) {
+    double t = (double)i / (INPUT_POINTS - 1);
+    inputs[n++] =
+        fn->log_spaced
+            ? fn->input_min * pow(fn->input_max / fn->input_min, t)
+            : fn->input_min + (fn->input_max - fn->input_min) * t;
+  }
+
+  if (fn->knee >= 0 && params[fn->knee] > 0) {
+    double knee = params[fn->knee];
+    for (int i = 0; i < KNEE_POINTS; i++) {
+      inputs[n++] = knee * (0.9 + 0.2 * i / (KNEE_POINTS - 1));
+    }
+  }
+  return n;
+}
+
+static void keep_worst(struct point_error *worst, int *len,
+                       const struct point_error *e) {
+  if (*len == WORST_LEN && e->rel_err <= worst[WORST_LEN - 1].rel_err) {
+    return;
+  }
+
+  int i = *len < WORST_LEN ? (*len)++ : WORST_LEN - 1;
+  while (i > 0 && worst[i - 1].rel_err < e->rel_err) {
+    worst[i] = worst[i - 1];
+    i--;
+  }
+  worst[i] = *e;
+}
+
+static void format_params(const struct precision_fn *fn, const double *params,
+                          char *buf, size_t size) {
+  buf[0] = '\0';
+  size_t len = 0;
+  for (int p = 0; p < MAX_PARAMS && fn->param_names[p] != NULL; p++) {
+    len += snprintf(buf + len, size - len, "%s%s=%g", p ? " " : "",
+                    fn->param_names[p], params[p]);
+  }
+}
+
+/* Error statistics of one function over its whole grid */
+struct fn_summary {
+  long points;
+  long traps;
+  double max_rel_err;
+  double sum_rel_err;
+};
+
+static void evaluate_params(const struct precision_fn *fn, const fpt *qparams,
+                            FILE *map, struct point_error *worst,
+                            int *worst_len, struct fn_summary *summary) {
+  double params[MAX_PARAMS] = {0};
+  for (int p = 0; p < MAX_PARAMS; p++) {
+    params[p] = fpt_todouble(qparams[p]);
+  }
+
+  static double inputs[INPUT_POINTS + KNEE_POINTS];
+  int n = input_grid(fn, params, inputs);
+
+  struct point_error max = {0};
+  double sum_rel_err = 0;
+  double max_abs_err = 0;
+  long traps = 0;
+
+  format_params(fn, params, max.params, sizeof(max.params));
+
+  for (int i = 0; i < n; i++) {
+    fpt x = fpt_rconst(inputs[i]);
+    double input = fpt_todouble(x);
+    double reference = fn->reference(params, input);
+
+    fpt value;
+    if (!eval_fixed(fn, qparams, x, &value)) {
+      traps++;
+      continue;
+    }
+
+    struct point_error e = {.input = input,
+                            .reference = reference,
+                            .value = fpt_todouble(value)};
+    e.abs_err = fabs(e.value - reference);
+    // Relative to the reference, but never below the resolution of fpt
+    e.rel_err = e.abs_err / fmax(fabs(reference), 1.0 / FIXEDPT_ONE);
+    memcpy(e.params, max.params, sizeof(e.params));
+
+    sum_rel_err += e.rel_err;
+    max_abs_err = fmax(max_abs_err, e.abs_err);
+    if (e.rel_err >= max.rel_err) {
+      max = e;
+    }
+    keep_worst(worst, worst_len, &e);
+  }
+
+  long evaluated = n - traps;
+  fprintf(map, "%d,%s,%s,%d,%ld,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+          FIXEDPT_BITS, fn->name, max.params, n, traps, max_abs_err,
+          max_abs_err * FIXEDPT_ONE, max.rel_err,
+          evaluated ? sum_rel_err / evaluated : 0, max.input, max.reference,
+          max.value);
+
+  summary->points += n;
+  summary->traps += traps;
+  summary->sum_rel_err += sum_rel_err;
+  summary->max_rel_err = fmax(summary->max_rel_err, max.rel_err);
+}
+
+/* Walk every combination of the function's parameter grid, like an odometer */
+static void evaluate(const struct precision_fn *fn, FILE *map,
+                     FILE *worst_csv) {
+  int idx[MAX_PARAMS] = {0};
+  struct point_error worst[WORST_LEN];
+  int worst_len = 0;
+  struct fn_summary summary = {0};
+
+  int params_len = 0;
+  while (params_len < MAX_PARAMS && fn->param_names[params_len] != NULL) {
+    params_len++;
+  }
+
+  for (;;) {
+    fpt qparams[MAX_PARAMS] = {0};
+    for (int p = 0; p < params_len; p++) {
+      qparams[p] = fpt_rconst(fn->grid[p][idx[p]]);
+    }
+    evaluate_params(fn, qparams, map, worst, &worst_len, &summary);
+
+    int p = 0;
+    while (p < params_len && ++idx[p] == fn->grid_len[p]) {
+      idx[p++] = 0;
+    }
+    if (p == params_len) {
+      break;
+    }
+  }
+
+  for (int i = 0; i < worst_len; i++) {
+    struct point_error *e = &worst[i];
+    fprintf(worst_csv, "%d,%s,%s,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+            FIXEDPT_BITS, fn->name, e->params, e->input, e->reference,
+            e->value, e->abs_err, e->abs_err * FIXEDPT_ONE, e->rel_err);
+  }
+
+  long evaluated = summary.points - summary.traps;
+  printf("  %-12s %7ld points %6ld traps  max rel err %-12.4g "
+         "mean rel err %.4g\n",
+         fn->name, summary.points, summary.traps, summary.max_rel_err,
+         evaluated ? summary.sum_rel_err / evaluated : 0);
+}
+
+static FILE *open_csv(const char *path, const char *header) {
+  FILE *csv = fopen(path, "a");
+  if (csv == NULL) {
+    perror(path);
+    exit(1);
+  }
+  fseek(csv, 0, SEEK_END);
+  if (ftell(csv) == 0) {
+    fprintf(csv, "%s\n", header);
+  }
+  return csv;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s map.csv worst.csv [name filter]\n", argv[0]);
+    return 1;
+  }
+  const char *filter = argc > 3 && argv[3][0] != '\0' ? argv[3] : NULL;
+
+  FILE *map = open_csv(argv[1], "bits,function,params,points,traps,"
+                                "max_abs_err,max_ulps,max_rel_err,"
+                                "mean_rel_err,worst_input,worst_reference,"
+                                "worst_value");
+  FILE *worst = open_csv(argv[2], "bits,function,params,input,reference,"
+                                  "value,abs_err,ulps,rel_err");
+
+  struct sigaction trap = {.sa_handler = on_trap};
+  sigaction(SIGFPE, &trap, NULL);
+
+  printf("[%s]\t\tFIXEDPT_BITS=%d\n", __FILE_NAME__, FIXEDPT_BITS);
+
+  for (size_t f = 0; f < FUNCTIONS_LEN; f++) {
+    if (filter == NULL || strstr(FUNCTIONS[f].name, filter) != NULL) {
+      evaluate(&FUNCTIONS[f], map, worst);
+    }
+  }
+
+  fclose(map);
+  fclose(worst);
+
+  return 0;
+}
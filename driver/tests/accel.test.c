@@ -122,6 +122,195 @@ static int test_rotation_no_accel(const char *filename, fpt param_sens_mult,
   return test_acceleration(filename, args);
 }
 
+/*
+ * Two mice accelerated with their own state, one frame each in turn, must
+ * move exactly as if each one had been moving alone.
+ */
+static int test_states_are_independent(void) {
+  struct accel_args args = {
+      .sens_mult = fpt_rconst(0.3),
+      .yx_ratio = FIXEDPT_ONE,
+      .input_dpi = fpt_fromint(1000),
+      .tag = linear,
+      .args = (union __accel_args){.linear = {.accel = fpt_rconst(0.05)}},
+  };
+  const int FRAMES = 64;
+
+  struct accel_state alone_a = {0}, alone_b = {0};
+  struct accel_state together_a = {0}, together_b = {0};
+
+  for (int i = 0; i < FRAMES; i++) {
+    int ax = i % 7 - 3, ay = i % 5 - 2;
+    int bx = 11 - i % 13, by = i % 3;
+
+    int ax_alone = ax, ay_alone = ay, bx_alone = bx, by_alone = by;
+    __f_accelerate(&ax_alone, &ay_alone, FIXEDPT_ONE, args, &alone_a);
+    __f_accelerate(&bx_alone, &by_alone, FIXEDPT_ONE, args, &alone_b);
+
+    __f_accelerate(&ax, &ay, FIXEDPT_ONE, args, &together_a);
+    __f_accelerate(&bx, &by, FIXEDPT_ONE, args, &together_b);
+
+    if (ax != ax_alone || ay != ay_alone || bx != bx_alone ||
+        by != by_alone) {
+      fprintf(stderr, "frame %d: a mouse's carry leaked into the other's\n",
+              i);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * The first frame after an idle period is accelerated as if it came at the
+ * polling interval of the previous movement, without its carry.
+ */
+static int test_idle_resets_movement(void) {
+  struct accel_args args = {
+      .sens_mult = fpt_rconst(0.3),
+      .yx_ratio = FIXEDPT_ONE,
+      .input_dpi = fpt_fromint(1000),
+      .tag = natural,
+      .args = (union __accel_args){.natural = {.decay_rate = fpt_rconst(0.1),
+                                               .offset = fpt_rconst(2),
+                                               .limit = fpt_rconst(1.5)}},
+  };
+  fpt poll_interval = frame_interval_ms(8000, 1000); // 125Hz, in us
+
+  struct accel_state state = {0};
+  for (int i = 0; i < 16; i++) {
+    int x = 7, y = -3;
+    __f_accelerate(&x, &y, poll_interval, args, &state);
+  }
+
+  int x = 5, y = 2;
+  __f_accelerate(&x, &y, frame_interval_ms(5000000, 1000), args, &state);
+
+  struct accel_state fresh = {0};
+  int expected_x = 5, expected_y = 2;
+  __f_accelerate(&expected_x, &expected_y, poll_interval, args, &fresh);
+
+  if (x != expected_x || y != expected_y) {
+    fprintf(stderr, "after idle: (%d, %d), expected (%d, %d)\n", x, y,
+            expected_x, expected_y);
+    return 1;
+  }
+  return 0;
+}
+
+static int test_frame_interval(void) {
+  assert(frame_interval_ms(8000, 1000) == fpt_fromint(8));
+  assert(frame_interval_ms(1500, 1000) == fpt_rconst(1.5));
+  assert(frame_interval_ms(99999, 1000) < fpt_fromint(IDLE_INTERVAL_MS));
+  assert(frame_interval_ms(1LL << 40, 1000) == fpt_fromint(IDLE_INTERVAL_MS));
+  return 0;
+}
+
+/* The curve itself, without skipping the speeds where it's flat */
+static fpt curve_sens(fpt speed, struct accel_args args) {
+  switch (args.tag) {
+  case linear:
+    return __linear_sens_fun(speed, args.args.linear);
+  case natural:
+    return __natural_sens_fun(speed, args.args.natural);
+  case synchronous:
+    return __synchronous_sens_fun(speed, args.args.synchronous);
+  case no_accel:
+  default:
+    return FIXEDPT_ONE;
+  }
+}
+
+static int check_constant_sens(const char *name, struct accel_args args) {
+  for (fpt speed = fpt_rconst(0.25); speed <= fpt_fromint(64);
+       speed += fpt_rconst(0.25)) {
+    fpt sens = fpt_mul(curve_sens(speed, args), args.sens_mult);
+    struct vector out = sensitivity(speed, args);
+
+    if (out.x != sens || out.y != fpt_mul(sens, args.yx_ratio)) {
+      fprintf(stderr, "%s, speed %s: the sensitivity isn't the curve's\n",
+              name, fptoa(speed));
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static struct accel_args linear_args(fpt accel, fpt offset, fpt output_cap) {
+  return (struct accel_args){
+      .sens_mult = fpt_rconst(0.3),
+      .yx_ratio = fpt_rconst(1.15),
+      .tag = linear,
+      .args = (union __accel_args){.linear = {.accel = accel,
+                                              .offset = offset,
+                                              .output_cap = output_cap}},
+  };
+}
+
+static struct accel_args natural_args(fpt decay_rate, fpt offset,
+                                      fpt limit) {
+  return (struct accel_args){
+      .sens_mult = fpt_rconst(0.3),
+      .yx_ratio = fpt_rconst(1.15),
+      .tag = natural,
+      .args = (union __accel_args){.natural = {.decay_rate = decay_rate,
+                                               .offset = offset,
+                                               .limit = limit}},
+  };
+}
+
+/*
+ * Where the curve is skipped for being flat, below its offset or everywhere
+ * for parameters that leave nothing to accelerate with, the sensitivity must
+ * be exactly what the curve would have given.
+ */
+static int test_constant_sens_matches_curve(void) {
+  struct accel_args no_accel_args = {.sens_mult = fpt_rconst(0.3),
+                                     .yx_ratio = fpt_rconst(1.15),
+                                     .tag = no_accel};
+  struct accel_args synchronous_args = {
+      .sens_mult = fpt_rconst(0.3),
+      .yx_ratio = fpt_rconst(1.15),
+      .tag = synchronous,
+      .args = (union __accel_args){
+          .synchronous = {.gamma = fpt_rconst(0.8),
+                          .smooth = fpt_rconst(0.5),
+                          .motivity = fpt_rconst(1.5),
+                          .sync_speed = fpt_fromint(32)}},
+  };
+
+  return check_constant_sens(
+             "linear, below the offset",
+             linear_args(fpt_rconst(0.05), fpt_fromint(8), fpt_fromint(2))) ||
+         check_constant_sens(
+             "linear, no accel",
+             linear_args(0, fpt_fromint(8), fpt_fromint(2))) ||
+         check_constant_sens("linear, no accel nor offset",
+                             linear_args(0, 0, 0)) ||
+         check_constant_sens(
+             "linear, no accel, a cap below 1",
+             linear_args(0, fpt_fromint(8), fpt_rconst(0.5))) ||
+         check_constant_sens(
+             "natural, below the offset",
+             natural_args(fpt_rconst(0.1), fpt_fromint(8), fpt_rconst(1.5))) ||
+         check_constant_sens(
+             "natural, a limit of 1",
+             natural_args(fpt_rconst(0.1), fpt_fromint(8), FIXEDPT_ONE)) ||
+         check_constant_sens(
+             "natural, a limit below 1",
+             natural_args(fpt_rconst(0.1), 0, fpt_rconst(0.5))) ||
+         check_constant_sens("natural, a limit of 0",
+                             natural_args(fpt_rconst(0.1), 0, 0)) ||
+         check_constant_sens(
+             "natural, no decay",
+             natural_args(0, fpt_fromint(8), fpt_rconst(1.5))) ||
+         check_constant_sens(
+             "natural, a negative decay",
+             natural_args(fpt_rconst(-0.1), 0, fpt_rconst(1.5))) ||
+         check_constant_sens("synchronous", synchronous_args) ||
+         check_constant_sens("no accel", no_accel_args);
+}
+
 #define test_linear(sens_mult, yx_ratio, accel, offset, cap)                   \
   assert(test_linear_acceleration(                                             \
              "SENS_MULT-" #sens_mult "-ACCEL-" #accel "-OFFSET" #offset        \
@@ -183,5 +372,10 @@ int main(void) {
   test_rotation(1, 45);
   test_rotation(1, 90);
 
+  assert(test_states_are_independent() == 0);
+  assert(test_idle_resets_movement() == 0);
+  assert(test_frame_interval() == 0);
+  assert(test_constant_sens_matches_curve() == 0);
+
   print_success;
 }
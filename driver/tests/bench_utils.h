@@ -0,0 +1,130 @@
+#ifndef _BENCH_UTILS_H_
+#define _BENCH_UTILS_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define bench_cycles() __rdtsc()
+#else
+#define bench_cycles() 0
+#endif
+
+/* Calls per timed sample, so that the clock reads are amortized */
+#define BENCH_BATCH 64
+#define BENCH_WARMUP_SAMPLES 500
+#define BENCH_SAMPLES 5000
+
+/* Number of precomputed inputs that a benchmark cycles through */
+#define BENCH_INPUTS 1024
+#define BENCH_INPUTS_MASK (BENCH_INPUTS - 1)
+
+typedef void (*bench_fn)(void *ctx, int batch);
+
+struct bench_stats {
+  double ns_mean;
+  double ns_min;
+  double ns_p50;
+  double ns_p90;
+  double ns_p99;
+  double cycles_p50;
+  double cycles_p99;
+};
+
+/* Keeps the compiler from optimizing away the results of a benchmark */
+static volatile int64_t bench_sink;
+
+static inline uint64_t bench_now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+  return (uint64_t)t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int n, double p) {
+  int idx = (int)(p * (n - 1) + 0.5);
+  return sorted[idx];
+}
+
+static struct bench_stats bench_run(bench_fn fn, void *ctx) {
+  static double ns[BENCH_SAMPLES];
+  static double cycles[BENCH_SAMPLES];
+
+  for (int i = 0; i < BENCH_WARMUP_SAMPLES; i++) {
+    fn(ctx, BENCH_BATCH);
+  }
+
+  double sum = 0;
+  for (int i = 0; i < BENCH_SAMPLES; i++) {
+    uint64_t c0 = bench_cycles();
+    uint64_t t0 = bench_now_ns();
+    fn(ctx, BENCH_BATCH);
+    uint64_t t1 = bench_now_ns();
+    uint64_t c1 = bench_cycles();
+
+    ns[i] = (double)(t1 - t0) / BENCH_BATCH;
+    cycles[i] = (double)(c1 - c0) / BENCH_BATCH;
+    sum += ns[i];
+  }
+
+  qsort(ns, BENCH_SAMPLES, sizeof(double), cmp_double);
+  qsort(cycles, BENCH_SAMPLES, sizeof(double), cmp_double);
+
+  return (struct bench_stats){
+      .ns_mean = sum / BENCH_SAMPLES,
+      .ns_min = ns[0],
+      .ns_p50 = percentile(ns, BENCH_SAMPLES, 0.50),
+      .ns_p90 = percentile(ns, BENCH_SAMPLES, 0.90),
+      .ns_p99 = percentile(ns, BENCH_SAMPLES, 0.99),
+      .cycles_p50 = percentile(cycles, BENCH_SAMPLES, 0.50),
+      .cycles_p99 = percentile(cycles, BENCH_SAMPLES, 0.99),
+  };
+}
+
+#define BENCH_CSV_HEADER                                                       \
+  "name,bits,ns_mean,ns_min,ns_p50,ns_p90,ns_p99,cycles_p50,cycles_p99"
+
+/*
+ * Print a human readable line to stdout, and append a CSV row to `csv`
+ * (if any) for the comparison against a saved baseline.
+ */
+static void bench_report(FILE *csv, const char *name, struct bench_stats s) {
+  printf("  %-44s %8.1fns/call (p50) %8.1fns (p99) %8.0f cycles/call (p50)\n",
+         name, s.ns_p50, s.ns_p99, s.cycles_p50);
+
+  if (csv != NULL) {
+    fprintf(csv, "%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.0f,%.0f\n", name,
+            FIXEDPT_BITS, s.ns_mean, s.ns_min, s.ns_p50, s.ns_p90, s.ns_p99,
+            s.cycles_p50, s.cycles_p99);
+  }
+}
+
+/* Deterministic xorshift, so that every run benches the same inputs */
+static uint64_t bench_rng_state = 0x9E3779B97F4A7C15ull;
+
+static inline double bench_rand_unit(void) {
+  bench_rng_state ^= bench_rng_state << 13;
+  bench_rng_state ^= bench_rng_state >> 7;
+  bench_rng_state ^= bench_rng_state << 17;
+  return (double)(bench_rng_state >> 11) / (double)(1ull << 53);
+}
+
+/* Log-normally distributed value with the given median */
+static inline double bench_rand_lognormal(double median, double sigma) {
+  double u1 = bench_rand_unit() + 1e-12;
+  double u2 = bench_rand_unit();
+  double gaussian = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+  return median * exp(sigma * gaussian);
+}
+
+#endif // !_BENCH_UTILS_H_
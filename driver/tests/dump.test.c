@@ -0,0 +1,64 @@
+#include "../dump.h"
+#include "test_utils.h"
+#include <assert.h>
+
+static unsigned long long read_le(const unsigned char *bytes, int n) {
+  unsigned long long value = 0;
+  for (int i = n - 1; i >= 0; i--) {
+    value = value << 8 | bytes[i];
+  }
+  return value;
+}
+
+static int test_layout(void) {
+  unsigned char buf[128] = {0};
+  struct dump_writer w;
+
+  dump_begin(&w, buf, sizeof(buf));
+  dump_open(&w, DUMP_OBJECT, "o");
+  dump_fpt(&w, "x", fpt_rconst(-1.5));
+  dump_str(&w, "s", "ab");
+  dump_close(&w);
+  long len = dump_end(&w);
+
+  // header, then "o" {"x": fpt, "s": str}
+  assert(len == 8 + 3 + (3 + 8) + (3 + 2 + 2) + 1);
+  assert(memcmp(buf, DUMP_MAGIC, 4) == 0);
+  assert(buf[4] == DUMP_VERSION);
+  assert(buf[5] == FIXEDPT_BITS);
+  assert(read_le(buf + 6, 2) == (unsigned long long)len);
+
+  const unsigned char *r = buf + DUMP_HEADER_LEN;
+  assert(r[0] == DUMP_OBJECT && r[1] == 1 && r[2] == 'o');
+  r += 3;
+  assert(r[0] == DUMP_FPT && r[1] == 1 && r[2] == 'x');
+  assert((long long)read_le(r + 3, 8) == (long long)fpt_rconst(-1.5));
+  r += 11;
+  assert(r[0] == DUMP_STR && read_le(r + 3, 2) == 2);
+  assert(memcmp(r + 5, "ab", 2) == 0);
+  r += 7;
+  assert(r[0] == DUMP_END);
+
+  return 0;
+}
+
+static int test_overflow(void) {
+  unsigned char buf[24] = {0};
+  struct dump_writer w;
+
+  dump_begin(&w, buf, sizeof(buf));
+  dump_u64(&w, "fits", 1);
+  assert(!w.overflow);
+  dump_u64(&w, "too_much", 2);
+  dump_close(&w); // would fit, but the dump is already unusable
+  assert(dump_end(&w) == -1);
+
+  return 0;
+}
+
+int main(void) {
+  assert(test_layout() == 0);
+  assert(test_overflow() == 0);
+
+  print_success;
+}
@@ -0,0 +1,412 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <kunit/test.h>
+#include <linux/input.h>
+#include <linux/ktime.h>
+
+#include "../../input_handler.h"
+
+/*
+ * The input_handler's event path, in a kernel: crafted batches of
+ * `input_value`s go straight through `maccel_events()`, the way the input
+ * core hands them over, and a registered virtual mouse checks that we sit
+ * in front of the other handlers. No hardware needed: it's loaded as a
+ * module under UML (see run_kunit.sh), or in a VM.
+ *
+ * Every case gets a mouse of its own, so its own carry: that's always in
+ * [0, 1), so integer sensitivities without rotation give exact outputs;
+ * the rotation cases allow for it.
+ */
+
+#define MACCEL_KUNIT_MAX_VALS 8
+#define MACCEL_KUNIT_PARAM_LEN 24
+
+#define REL(axis, v)                                                           \
+  ((struct input_value){.type = EV_REL, .code = REL_##axis, .value = (v)})
+#define KEY(key, v)                                                            \
+  ((struct input_value){.type = EV_KEY, .code = (key), .value = (v)})
+#define SYN ((struct input_value){.type = EV_SYN, .code = SYN_REPORT})
+
+struct maccel_kunit_ctx {
+  struct input_dev *dev;
+  struct maccel_device device;
+  struct input_value vals[MACCEL_KUNIT_MAX_VALS];
+
+  /* The parameters are strings, like when they're written to sysfs */
+  char sens_mult[MACCEL_KUNIT_PARAM_LEN];
+  char yx_ratio[MACCEL_KUNIT_PARAM_LEN];
+  char angle_rotation[MACCEL_KUNIT_PARAM_LEN];
+  char accel[MACCEL_KUNIT_PARAM_LEN];
+};
+
+static struct {
+  char *sens_mult;
+  char *yx_ratio;
+  char *angle_rotation;
+  char *accel;
+  unsigned char mode;
+} saved_params;
+
+static void set_param(char **param, char *buf, fpt value) {
+  snprintf(buf, MACCEL_KUNIT_PARAM_LEN, "%lld", (long long)value);
+  *param = buf;
+}
+
+static int maccel_kunit_init(struct kunit *test) {
+  struct maccel_kunit_ctx *ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+  KUNIT_ASSERT_NOT_NULL(test, ctx);
+
+  saved_params.sens_mult = PARAM_SENS_MULT;
+  saved_params.yx_ratio = PARAM_YX_RATIO;
+  saved_params.angle_rotation = PARAM_ANGLE_ROTATION;
+  saved_params.accel = PARAM_ACCEL;
+  saved_params.mode = PARAM_MODE;
+  test->priv = ctx;
+
+  PARAM_MODE = no_accel;
+  set_param(&PARAM_SENS_MULT, ctx->sens_mult, FIXEDPT_ONE);
+  set_param(&PARAM_YX_RATIO, ctx->yx_ratio, FIXEDPT_ONE);
+  PARAM_ANGLE_ROTATION = "0";
+
+  /* Never registered: `maccel_events` only needs its `max_vals` */
+  ctx->dev = input_allocate_device();
+  KUNIT_ASSERT_NOT_NULL(test, ctx->dev);
+  ctx->dev->max_vals = MACCEL_KUNIT_MAX_VALS;
+
+  ctx->device.handle.dev = ctx->dev;
+  ctx->device.handle.handler = &maccel_handler;
+  ctx->device.handle.name = "maccel_kunit";
+
+  return 0;
+}
+
+static void maccel_kunit_exit(struct kunit *test) {
+  struct maccel_kunit_ctx *ctx = test->priv;
+  if (!ctx)
+    return;
+
+  PARAM_SENS_MULT = saved_params.sens_mult;
+  PARAM_YX_RATIO = saved_params.yx_ratio;
+  PARAM_ANGLE_ROTATION = saved_params.angle_rotation;
+  PARAM_ACCEL = saved_params.accel;
+  PARAM_MODE = saved_params.mode;
+
+  input_free_device(ctx->dev);
+}
+
+/* Hand the batch over to the handler, returns the count it leaves */
+static unsigned int run_batch(struct maccel_kunit_ctx *ctx,
+                              const struct input_value *batch,
+                              unsigned int count) {
+  memcpy(ctx->vals, batch, count * sizeof(*batch));
+#if __cleanup_events
+  return maccel_events(&ctx->device.handle, ctx->vals, count);
+#else
+  maccel_events(&ctx->device.handle, ctx->vals, count);
+  return ctx->dev->num_vals;
+#endif
+}
+
+static void expect_value(struct kunit *test, struct input_value actual,
+                         struct input_value expected) {
+  KUNIT_EXPECT_EQ(test, actual.type, expected.type);
+  KUNIT_EXPECT_EQ(test, actual.code, expected.code);
+  KUNIT_EXPECT_EQ(test, actual.value, expected.value);
+}
+
+static void maccel_passes_frames_through_at_unit_sensitivity(
+    struct kunit *test) {
+  struct maccel_kunit_ctx *ctx = test->priv;
+  const struct input_value batch[] = {REL(X, 3), REL(Y, -4), SYN};
+
+  unsigned int count = run_batch(ctx, batch, ARRAY_SIZE(batch));
+
+  KUNIT_ASSERT_EQ(test, count, 3);
+  expect_value(test, ctx->vals[0], REL(X, 3));
+  expect_value(test, ctx->vals[1], REL(Y, -4));
+  expect_value(test, ctx->vals[2], SYN);
+  KUNIT_EXPECT_EQ(test, ctx->dev->num_vals, 3);
+}
+
+static void maccel_scales_frames(struct kunit *test) {
+  struct maccel_kunit_ctx *ctx = test->priv;
+  const struct input_value batch[] = {REL(X, 3), REL(Y, -4), SYN};
+
+  set_param(&PARAM_SENS_MULT, ctx->sens_mult, fpt_fromint(2));
+  set_param(&PARAM_YX_RATIO, ctx->yx_ratio, fpt_fromint(3));
+  unsigned int count = run_batch(ctx, batch, ARRAY_SIZE(batch));
+
+  KUNIT_ASSERT_EQ(test, count, 3);
+  expect_value(test, ctx->vals[0], REL(X, 6));
+  expect_value(test, ctx->vals[1], REL(Y, -24));
+  expect_value(test, ctx->vals[2], SYN);
+}
+
+static void maccel_compacts_zeroed_axes(struct kunit *test) {
+  struct maccel_kunit_ctx *ctx = test->priv;
+  const struct input_value batch[] = {
+      KEY(BTN_LEFT, 1), REL(X, 5), REL(WHEEL, 1), REL(Y, 4), SYN,
+  };
+
+  /* Y's sensitivity is 0, so its event goes, and nothing else moves */
+  set_param(&PARAM_YX_RATIO, ctx->yx_ratio, 0);
+  unsigned int count = run_batch(ctx, batch, ARRAY_SIZE(batch));
+
+  KUNIT_ASSERT_EQ(test, count, 4);
+  expect_value(test, ctx->vals[0], KEY(BTN_LEFT, 1));
+  expect_value(test, ctx->vals[1], REL(X, 5));
+  expect_value(test, ctx->vals[2], REL(WHEEL, 1));
+  expect_value(test, ctx->vals[3], SYN);
+  KUNIT_EXPECT_EQ(test, ctx->dev->num_vals, 4);
+}
+
+static void maccel_compacts_a_frame_down_to_its_syn(struct kunit *test) {
+  struct maccel_kunit_ctx *ctx = test->priv;
+  const struct input_value batch[] = {REL(X, 5), REL(Y, 4), SYN};
+
+  set_param(&PARAM_SENS_MULT, ctx->sens_mult, 0);
+  unsigned int count = run_batch(ctx, batch, ARRAY_SIZE(batch));
+
+  KUNIT_ASSERT_EQ(test, count, 1);
+  expect_value(test, ctx->vals[0], SYN);
+}
+
+static void maccel_injects_the_rotated_axis(struct kunit *test) {
+#if __cleanup_events
+  struct maccel_kunit_ctx *ctx = test->priv;
+  const struct input_value batch[] = {KEY(BTN_LEFT, 0), REL(X, 10), SYN};
+
+  set_param(&PARAM_ANGLE_ROTATION, ctx->angle_rotation, fpt_fromint(45));
+  unsigned int count = run_batch(ctx, batch, ARRAY_SIZE(batch));
+
+  /* (10, 0) => (7, 7), give or take the carry */
+  KUNIT_ASSERT_EQ(test, count, 4);
+  expect_value(test, ctx->vals[0], KEY(BTN_LEFT, 0));
+  KUNIT_EXPECT_EQ(test, ctx->vals[1].code, REL_X);
+  KUNIT_EXPECT_TRUE(test, ctx->vals[1].value >= 7 && ctx->vals[1].value <= 8);
+  KUNIT_EXPECT_EQ(test, ctx->vals[2].type, EV_REL);
+  KUNIT_EXPECT_EQ(test, ctx->vals[2].code, REL_Y);
+  KUNIT_EXPECT_TRUE(test, ctx->vals[2].value >= 7 && ctx->vals[2].value <= 8);
+  expect_value(test, ctx->vals[3], SYN);
+#else
+  kunit_skip(test, "the events can't be injected before 6.11");
+#endif
+}
+
+static void maccel_replaces_the_rotated_away_axis(struct kunit *test) {
+#if __cleanup_events
+  struct maccel_kunit_ctx *ctx = test->priv;
+  const struct input_value batch[] = {REL(X, 10), SYN};
+
+  set_param(&PARAM_ANGLE_ROTATION, ctx->angle_rotation, fpt_fromint(90));
+  unsigned int count = run_batch(ctx, batch, ARRAY_SIZE(batch));
+
+  /* (10, 0) => (0, 10): X is compacted away, Y is injected */
+  KUNIT_ASSERT_TRUE(test, count >= 2 && count <= 3);
+  KUNIT_EXPECT_EQ(test, ctx->vals[count - 2].type, EV_REL);
+  KUNIT_EXPECT_EQ(test, ctx->vals[count - 2].code, REL_Y);
+  KUNIT_EXPECT_TRUE(test, ctx->vals[count - 2].value >= 9 &&
+                              ctx->vals[count - 2].value <= 10);
+  expect_value(test, ctx->vals[count - 1], SYN);
+#else
+  kunit_skip(test, "the events can't be injected before 6.11");
+#endif
+}
+
+static void maccel_injects_within_max_vals(struct kunit *test) {
+#if __cleanup_events
+  struct maccel_kunit_ctx *ctx = test->priv;
+  const struct input_value batch[] = {REL(X, 10), SYN};
+
+  /* The input core's buffer is full, the synthetic Y is dropped */
+  ctx->dev->max_vals = 2;
+  set_param(&PARAM_ANGLE_ROTATION, ctx->angle_rotation, fpt_fromint(45));
+  unsigned int count = run_batch(ctx, batch, ARRAY_SIZE(batch));
+
+  KUNIT_ASSERT_EQ(test, count, 2);
+  KUNIT_EXPECT_EQ(test, ctx->vals[0].code, REL_X);
+  expect_value(test, ctx->vals[1], SYN);
+  KUNIT_EXPECT_EQ(test, ctx->dev->num_vals, 2);
+
+  /* One more slot, and it fits */
+  ctx->dev->max_vals = 3;
+  count = run_batch(ctx, batch, ARRAY_SIZE(batch));
+
+  KUNIT_ASSERT_EQ(test, count, 3);
+  KUNIT_EXPECT_EQ(test, ctx->vals[1].code, REL_Y);
+  expect_value(test, ctx->vals[2], SYN);
+#else
+  kunit_skip(test, "the events can't be injected before 6.11");
+#endif
+}
+
+/* Receives what's left of the events after maccel */
+static struct {
+  struct input_handle handle;
+  int x;
+  int y;
+  int frames;
+} observer;
+
+static void maccel_kunit_observe(struct input_handle *handle,
+                                 unsigned int type, unsigned int code,
+                                 int value) {
+  if (type == EV_REL && code == REL_X)
+    observer.x += value;
+  else if (type == EV_REL && code == REL_Y)
+    observer.y += value;
+  else if (type == EV_SYN && code == SYN_REPORT)
+    observer.frames++;
+}
+
+static int maccel_kunit_observer_connect(struct input_handler *handler,
+                                         struct input_dev *dev,
+                                         const struct input_device_id *id) {
+  int error;
+
+  observer.handle.dev = dev;
+  observer.handle.handler = handler;
+  observer.handle.name = "maccel_kunit_observer";
+
+  error = input_register_handle(&observer.handle);
+  if (error)
+    return error;
+
+  error = input_open_device(&observer.handle);
+  if (error)
+    input_unregister_handle(&observer.handle);
+  return error;
+}
+
+static void maccel_kunit_observer_disconnect(struct input_handle *handle) {
+  input_close_device(handle);
+  input_unregister_handle(handle);
+}
+
+#define MACCEL_KUNIT_VENDOR 0x6d61
+#define MACCEL_KUNIT_PRODUCT 0x6b75
+
+static const struct input_device_id observer_ids[] = {
+    {.flags = INPUT_DEVICE_ID_MATCH_VENDOR | INPUT_DEVICE_ID_MATCH_PRODUCT,
+     .vendor = MACCEL_KUNIT_VENDOR,
+     .product = MACCEL_KUNIT_PRODUCT},
+    {},
+};
+
+static struct input_handler observer_handler = {
+    .event = maccel_kunit_observe,
+    .connect = maccel_kunit_observer_connect,
+    .disconnect = maccel_kunit_observer_disconnect,
+    .name = "maccel_kunit_observer",
+    .id_table = observer_ids,
+};
+
+static void maccel_goes_first_on_a_registered_mouse(struct kunit *test) {
+  struct maccel_kunit_ctx *ctx = test->priv;
+  struct input_dev *dev = input_allocate_device();
+  KUNIT_ASSERT_NOT_NULL(test, dev);
+
+  dev->name = "maccel kunit mouse";
+  dev->id.bustype = BUS_VIRTUAL;
+  dev->id.vendor = MACCEL_KUNIT_VENDOR;
+  dev->id.product = MACCEL_KUNIT_PRODUCT;
+  input_set_capability(dev, EV_REL, REL_X);
+  input_set_capability(dev, EV_REL, REL_Y);
+  input_set_capability(dev, EV_KEY, BTN_LEFT);
+
+  int error = input_register_device(dev);
+  if (error) {
+    input_free_device(dev);
+    KUNIT_FAIL(test, "failed to register the mouse: %d", error);
+    return;
+  }
+
+  memset(&observer, 0, sizeof(observer));
+  /* The observer first, so that maccel has to jump ahead of it */
+  KUNIT_EXPECT_EQ(test, input_register_handler(&observer_handler), 0);
+  KUNIT_EXPECT_EQ(test, input_register_handler(&maccel_handler), 0);
+
+  mutex_lock(&dev->mutex);
+  struct input_handle *first =
+      list_first_entry_or_null(&dev->h_list, struct input_handle, d_node);
+  KUNIT_EXPECT_PTR_EQ(test, first ? first->handler : NULL, &maccel_handler);
+  mutex_unlock(&dev->mutex);
+
+  set_param(&PARAM_SENS_MULT, ctx->sens_mult, fpt_fromint(2));
+  input_report_rel(dev, REL_X, 3);
+  input_report_rel(dev, REL_Y, -4);
+  input_sync(dev);
+
+  KUNIT_EXPECT_EQ(test, observer.frames, 1);
+  KUNIT_EXPECT_EQ(test, observer.x, 6);
+  KUNIT_EXPECT_EQ(test, observer.y, -8);
+
+  input_unregister_handler(&maccel_handler);
+  input_unregister_handler(&observer_handler);
+  input_unregister_device(dev);
+}
+
+#define MACCEL_KUNIT_BATCHES 10000
+
+static void time_batches(struct kunit *test, const char *label) {
+  struct maccel_kunit_ctx *ctx = test->priv;
+  u64 total = 0, fastest = U64_MAX, slowest = 0;
+
+  for (int i = 0; i < MACCEL_KUNIT_BATCHES; i++) {
+    const struct input_value batch[] = {REL(X, 1 + i % 13), REL(Y, -(i % 7)),
+                                        SYN};
+
+    u64 start = ktime_get_ns();
+    run_batch(ctx, batch, ARRAY_SIZE(batch));
+    u64 elapsed = ktime_get_ns() - start;
+
+    total += elapsed;
+    fastest = min(fastest, elapsed);
+    slowest = max(slowest, elapsed);
+  }
+
+  kunit_info(test, "%s: %llu ns/batch on average (min %llu, max %llu)",
+             label, div_u64(total, MACCEL_KUNIT_BATCHES), fastest, slowest);
+}
+
+/*
+ * Not a pass or fail: it logs how long a batch takes in the handler,
+ * to compare across kernels and changes of the event path.
+ */
+static void maccel_times_batches(struct kunit *test) {
+  struct maccel_kunit_ctx *ctx = test->priv;
+
+  time_batches(test, "no_accel");
+
+  PARAM_MODE = linear;
+  set_param(&PARAM_ACCEL, ctx->accel,
+            fpt_div(fpt_fromint(3), fpt_fromint(10)));
+  time_batches(test, "linear");
+
+  set_param(&PARAM_ANGLE_ROTATION, ctx->angle_rotation, fpt_fromint(30));
+  time_batches(test, "linear, rotated");
+}
+
+static struct kunit_case maccel_test_cases[] = {
+    KUNIT_CASE(maccel_passes_frames_through_at_unit_sensitivity),
+    KUNIT_CASE(maccel_scales_frames),
+    KUNIT_CASE(maccel_compacts_zeroed_axes),
+    KUNIT_CASE(maccel_compacts_a_frame_down_to_its_syn),
+    KUNIT_CASE(maccel_injects_the_rotated_axis),
+    KUNIT_CASE(maccel_replaces_the_rotated_away_axis),
+    KUNIT_CASE(maccel_injects_within_max_vals),
+    KUNIT_CASE(maccel_goes_first_on_a_registered_mouse),
+    KUNIT_CASE(maccel_times_batches),
+    {},
+};
+
+static struct kunit_suite maccel_test_suite = {
+    .name = "maccel",
+    .init = maccel_kunit_init,
+    .exit = maccel_kunit_exit,
+    .test_cases = maccel_test_cases,
+};
+
+kunit_test_suite(maccel_test_suite);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("KUnit tests for maccel's input handler");
@@ -0,0 +1,38 @@
+#!/bin/sh
+
+# Run maccel_kunit.c under UML, as an out-of-tree module. No mouse needed.
+#
+# UML's input core is the kernel's own (drivers/input, with CONFIG_INPUT),
+# so the handler is registered, ordered and fed events the way it is on any
+# other arch. Only the timings are UML's: for numbers of a real CPU, load
+# the suite in a VM of that arch instead (`make kunit_module`).
+#
+# kunit.py builds a UML kernel with KUnit from .kunitconfig, the suite is
+# built against it with this directory's Kbuild, then the kernel boots with
+# the host's files as its root to load the module (see uml_init.sh), and
+# kunit.py parses the results. The kernel tree isn't modified: the kernel is
+# built in $KUNIT_BUILD_DIR, the module here.
+#
+# Usage: KSRC=path/to/linux sh tests/kunit/run_kunit.sh
+
+if [ -z "$KSRC" ] || [ ! -x "$KSRC/tools/testing/kunit/kunit.py" ]; then
+  echo "KSRC has to be a kernel source tree (with tools/testing/kunit)" >&2
+  exit 1
+fi
+
+KUNIT_DIR=$(realpath "$(dirname "$0")")
+KSRC=$(realpath "$KSRC")
+KUNIT_BUILD_DIR=$(realpath -m "${KUNIT_BUILD_DIR:-$KUNIT_DIR/.build}")
+KUNIT_PY="$KSRC/tools/testing/kunit/kunit.py"
+
+"$KUNIT_PY" build --arch=um \
+  --kunitconfig="$KUNIT_DIR/.kunitconfig" \
+  --build_dir="$KUNIT_BUILD_DIR" || exit 1
+
+make -C "$KSRC" ARCH=um O="$KUNIT_BUILD_DIR" M="$KUNIT_DIR" modules || exit 1
+
+# The results are KTAP on the console, with the rest of the boot log
+"$KUNIT_BUILD_DIR/linux" mem=256M con=null con0=fd:0,fd:1 \
+  root=/dev/root rootfstype=hostfs rootflags=/ rw \
+  init="$KUNIT_DIR/uml_init.sh" maccel_kunit_ko="$KUNIT_DIR/maccel_kunit.ko" \
+  </dev/null 2>&1 | tee "$KUNIT_BUILD_DIR/test.log" | "$KUNIT_PY" parse
@@ -0,0 +1,9 @@
+#!/bin/sh
+
+# The init of the UML kernel booted by run_kunit.sh, with the host's files as
+# its root: load the suite, which prints its results to the console, and
+# power off. $maccel_kunit_ko comes from the kernel's command line.
+
+mount -t proc proc /proc
+insmod "$maccel_kunit_ko"
+echo o >/proc/sysrq-trigger
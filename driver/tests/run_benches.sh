@@ -0,0 +1,48 @@
+#!/bin/sh
+
+# Build and run every tests/*.bench.c for both fixed-point widths,
+# collecting the results in $BENCH_OUT (CSV). If $BENCH_BASELINE exists,
+# fail when the median ns/call of any benchmark regressed by more than
+# $BENCH_THRESHOLD percent.
+
+BENCH_OUT=${BENCH_OUT:-tests/bench/latest.csv}
+BENCH_THRESHOLD=${BENCH_THRESHOLD:-10}
+BENCH_CFLAGS=${BENCH_CFLAGS:--O2}
+
+mkdir -p "$(dirname "$BENCH_OUT")"
+echo "name,bits,ns_mean,ns_min,ns_p50,ns_p90,ns_p99,cycles_p50,cycles_p99" >"$BENCH_OUT"
+
+for bits in 32 64; do
+  for bench in tests/*.bench.c; do
+    gcc "$bench" -o maccel_bench -lm $BENCH_CFLAGS -DFIXEDPT_BITS=$bits || exit 1
+    ./maccel_bench "$BENCH_OUT" "$BENCH_NAME" || exit 1
+    rm maccel_bench
+  done
+done
+
+echo "results written to $BENCH_OUT"
+
+if [ -z "$BENCH_BASELINE" ] || [ ! -f "$BENCH_BASELINE" ]; then
+  exit 0
+fi
+
+echo "comparing against $BENCH_BASELINE (threshold: ${BENCH_THRESHOLD}%)"
+
+awk -F, -v threshold="$BENCH_THRESHOLD" '
+  FNR == 1 { next }
+  NR == FNR { baseline[$1 "@" $2] = $5; next }
+  {
+    key = $1 "@" $2
+    if (!(key in baseline)) next
+    change = ($5 - baseline[key]) / baseline[key] * 100
+    status = change > threshold ? "REGRESSION" : "ok"
+    if (change > threshold) failed++
+    printf "  %-10s %-44s %2s-bit %8.1fns -> %8.1fns (%+.1f%%)\n", status, $1, $2, baseline[key], $5, change
+  }
+  END {
+    if (failed) {
+      printf "%d benchmark(s) regressed by more than %s%%\n", failed, threshold
+      exit 1
+    }
+  }
+' "$BENCH_BASELINE" "$BENCH_OUT"
@@ -0,0 +1,21 @@
+#!/bin/sh
+
+# Build and run every tests/*.precision.c for both fixed-point widths,
+# collecting the error map and the worst points of every function in
+# $PRECISION_OUT/map.csv and $PRECISION_OUT/worst.csv.
+
+PRECISION_OUT=${PRECISION_OUT:-tests/precision}
+
+mkdir -p "$PRECISION_OUT"
+rm -f "$PRECISION_OUT/map.csv" "$PRECISION_OUT/worst.csv"
+
+for bits in 32 64; do
+  for harness in tests/*.precision.c; do
+    gcc "$harness" -o maccel_precision -lm -O2 -DFIXEDPT_BITS=$bits || exit 1
+    ./maccel_precision "$PRECISION_OUT/map.csv" "$PRECISION_OUT/worst.csv" \
+      "$PRECISION_NAME" || exit 1
+    rm maccel_precision
+  done
+done
+
+echo "results written to $PRECISION_OUT/map.csv and $PRECISION_OUT/worst.csv"
@@ -3,12 +3,13 @@
 
 #ifdef __KERNEL__
 #include <linux/types.h>
-#else
+#elif !defined __bpf__ // vmlinux.h has them, see fixedptc.h
 #include <stdint.h>
 #endif
 
 #include "dbg.h"
 
+#ifndef __bpf__ // x86 only, and the HID-BPF program (32 bits) doesn't need it
 static inline int64_t div128_s64_s64_s64(int64_t high, int64_t low,
                                          int64_t divisor) {
   int64_t result;
@@ -16,12 +17,15 @@ static inline int64_t div128_s64_s64_s64(int64_t high, int64_t low,
   // high -> rdx
   // low -> rax
   uint64_t remainder;
-  __asm__("idivq %[B]"
+  // volatile: idivq traps, so it must not be hoisted out of the branches
+  // that guard against a zero divisor.
+  __asm__ volatile("idivq %[B]"
           : "=a"(result), "=d"(remainder)
           : [B] "r"(divisor), "a"(low), "d"(high));
 
   return result;
 }
+#endif
 
 static inline int is_digit(char c) { return '0' <= c && c <= '9'; }
 
@@ -0,0 +1,420 @@
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "maccel_hid.h"
+
+/*
+ * The beginning of the kernel's `struct hid_bpf_ops` (include/linux/hid_bpf.h)
+ * which is all we need of it to tell the skeleton which device to attach to.
+ * The kernel keeps `hid_id` first, for us to set it before loading.
+ */
+struct hid_bpf_ops {
+  int hid_id;
+  unsigned int flags;
+};
+
+#include "maccel.skel.h"
+
+/*
+ * Attach maccel.bpf.c to every mouse, and keep its parameters in sync with
+ * the ones set by `maccel set --engine` (or the TUI), until interrupted.
+ *
+ * The kernel module must not be loaded, or the mice would be accelerated
+ * twice; so the CLI keeps the parameters in /var/opt/maccel/parameters,
+ * where we read them from every 500ms.
+ *
+ * Usage: maccel-hid-bpf
+ */
+
+#define MAX_DEVICES 16
+#define PARAMS_DIR "/var/opt/maccel/parameters"
+#define HID_DEVICES_DIR "/sys/bus/hid/devices"
+
+struct attached_device {
+  char name[64];
+  unsigned int hid_id;
+  struct maccel_bpf *skel;
+  struct bpf_link *link;
+};
+
+static struct attached_device devices[MAX_DEVICES];
+/* Our own references to the shared maps, which outlive any mouse */
+static int params_fd = -1;
+static int devices_fd = -1;
+/* What's in `maccel_params` */
+static struct accel_args params;
+
+/* Item tags of the HID report descriptor, see the HID 1.11 spec 6.2.2 */
+enum {
+  ITEM_MAIN = 0,
+  ITEM_GLOBAL = 1,
+  ITEM_LOCAL = 2,
+
+  MAIN_INPUT = 0x8,
+  GLOBAL_USAGE_PAGE = 0x0,
+  GLOBAL_REPORT_SIZE = 0x7,
+  GLOBAL_REPORT_ID = 0x8,
+  GLOBAL_REPORT_COUNT = 0x9,
+  LOCAL_USAGE = 0x0,
+  LOCAL_USAGE_MIN = 0x1,
+  LOCAL_USAGE_MAX = 0x2,
+
+  INPUT_CONSTANT = 1 << 0,
+  INPUT_RELATIVE = 1 << 2,
+
+  USAGE_PAGE_GENERIC_DESKTOP = 0x01,
+  USAGE_X = 0x30,
+  USAGE_Y = 0x31,
+};
+
+/*
+ * Find the first input report with a relative X and Y, i.e. the one that
+ * moves the pointer. Returns -1 if the device has none: it's not a mouse.
+ */
+static int find_layout(const unsigned char *desc, size_t len,
+                       struct report_layout *layout) {
+  unsigned int usage_page = 0, report_size = 0, report_count = 0;
+  unsigned int report_id = 0;
+  unsigned int usages[32], n_usages = 0, usage_min = 0, usage_max = 0;
+  /* Bits so far in each report, including the id */
+  static unsigned int offsets[256];
+  memset(offsets, 0, sizeof(offsets));
+
+  struct report_layout found[256] = {0};
+
+  for (size_t i = 0; i < len;) {
+    unsigned char prefix = desc[i++];
+    if (prefix == 0xfe) { // long item, nothing we need
+      if (i + 1 < len) {
+        i += 2 + desc[i];
+      }
+      continue;
+    }
+
+    unsigned int size = prefix & 3 ? 1 << ((prefix & 3) - 1) : 0;
+    unsigned int type = (prefix >> 2) & 3;
+    unsigned int tag = prefix >> 4;
+    if (i + size > len) {
+      break;
+    }
+    unsigned int data = 0;
+    for (unsigned int b = 0; b < size; b++) {
+      data |= desc[i + b] << (8 * b);
+    }
+    i += size;
+
+    if (type == ITEM_GLOBAL) {
+      switch (tag) {
+      case GLOBAL_USAGE_PAGE:
+        usage_page = data;
+        break;
+      case GLOBAL_REPORT_SIZE:
+        report_size = data;
+        break;
+      case GLOBAL_REPORT_COUNT:
+        report_count = data;
+        break;
+      case GLOBAL_REPORT_ID:
+        report_id = data & 0xff;
+        if (offsets[report_id] == 0) {
+          offsets[report_id] = 8; // the id's byte
+        }
+        break;
+      }
+    } else if (type == ITEM_LOCAL) {
+      // A 4 bytes usage carries its own page
+      unsigned int usage = size == 4 ? data : (usage_page << 16) | data;
+      switch (tag) {
+      case LOCAL_USAGE:
+        if (n_usages < 32) {
+          usages[n_usages++] = usage;
+        }
+        break;
+      case LOCAL_USAGE_MIN:
+        usage_min = usage;
+        break;
+      case LOCAL_USAGE_MAX:
+        usage_max = usage;
+        break;
+      }
+    } else if (type == ITEM_MAIN) {
+      if (tag == MAIN_INPUT) {
+        for (unsigned int f = 0; f < report_count; f++) {
+          unsigned int usage =
+              f < n_usages ? usages[f]
+              : n_usages   ? usages[n_usages - 1]
+              : usage_min + f <= usage_max ? usage_min + f
+                                           : usage_max;
+          unsigned int offset = offsets[report_id] + f * report_size;
+
+          if ((data & INPUT_CONSTANT) || !(data & INPUT_RELATIVE) ||
+              usage >> 16 != USAGE_PAGE_GENERIC_DESKTOP ||
+              offset + report_size > MACCEL_HID_REPORT_MAX * 8 ||
+              report_size > 32) {
+            continue;
+          }
+          if ((usage & 0xffff) == USAGE_X && !found[report_id].x_bits) {
+            found[report_id].x_offset = offset;
+            found[report_id].x_bits = report_size;
+          } else if ((usage & 0xffff) == USAGE_Y &&
+                     !found[report_id].y_bits) {
+            found[report_id].y_offset = offset;
+            found[report_id].y_bits = report_size;
+          }
+        }
+        offsets[report_id] += report_size * report_count;
+      }
+      // Local items only last until the next main item
+      n_usages = usage_min = usage_max = 0;
+    }
+  }
+
+  for (int id = 0; id < 256; id++) {
+    if (found[id].x_bits && found[id].y_bits) {
+      *layout = found[id];
+      layout->report_id = id;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static int read_descriptor(const char *name, unsigned char *desc,
+                           size_t size) {
+  char path[300];
+  snprintf(path, sizeof(path), HID_DEVICES_DIR "/%s/report_descriptor",
+           name);
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return -1;
+  }
+  int len = fread(desc, 1, size, file);
+  fclose(file);
+  return len;
+}
+
+static void attach(const char *name) {
+  unsigned int hid_id;
+  // e.g. 0003:046D:C077.0005
+  if (sscanf(name, "%*x:%*x:%*x.%x", &hid_id) != 1) {
+    return;
+  }
+
+  unsigned char desc[4096];
+  struct device_state state = {0};
+  int len = read_descriptor(name, desc, sizeof(desc));
+  if (len <= 0 || find_layout(desc, len, &state.layout) < 0) {
+    return; // not a mouse
+  }
+
+  struct attached_device *dev = NULL;
+  for (int i = 0; i < MAX_DEVICES && dev == NULL; i++) {
+    if (devices[i].skel == NULL) {
+      dev = &devices[i];
+    }
+  }
+  if (dev == NULL) {
+    fprintf(stderr, "skipped %s: too many mice\n", name);
+    return;
+  }
+
+  // A struct_ops is attached to a single device, so every mouse gets its
+  // own instance of the program, sharing the maps of the first one.
+  struct maccel_bpf *skel = maccel_bpf__open();
+  if (skel == NULL) {
+    fprintf(stderr, "failed to open the BPF program\n");
+    return;
+  }
+  skel->struct_ops.maccel->hid_id = hid_id;
+
+  if (params_fd >= 0 &&
+      (bpf_map__reuse_fd(skel->maps.maccel_params, params_fd) ||
+       bpf_map__reuse_fd(skel->maps.maccel_devices, devices_fd))) {
+    fprintf(stderr, "failed to share the maps with %s\n", name);
+    goto err_destroy;
+  }
+
+  int error = maccel_bpf__load(skel);
+  if (error) {
+    fprintf(stderr, "failed to load the BPF program for %s: %s\n", name,
+            strerror(-error));
+    goto err_destroy;
+  }
+  if (params_fd < 0) {
+    params_fd = dup(bpf_map__fd(skel->maps.maccel_params));
+    devices_fd = dup(bpf_map__fd(skel->maps.maccel_devices));
+    unsigned int zero = 0;
+    bpf_map_update_elem(params_fd, &zero, &params, BPF_ANY);
+  }
+
+  bpf_map__update_elem(skel->maps.maccel_devices, &hid_id, sizeof(hid_id),
+                       &state, sizeof(state), BPF_ANY);
+
+  dev->link = bpf_map__attach_struct_ops(skel->maps.maccel);
+  if (dev->link == NULL) {
+    fprintf(stderr, "failed to attach to %s: %s\n", name, strerror(errno));
+    bpf_map__delete_elem(skel->maps.maccel_devices, &hid_id, sizeof(hid_id),
+                         0);
+    goto err_destroy;
+  }
+
+  dev->skel = skel;
+  dev->hid_id = hid_id;
+  snprintf(dev->name, sizeof(dev->name), "%s", name);
+  fprintf(stderr,
+          "attached to %s: report %d, X %d bits at %d, Y %d bits at %d\n", name,
+          state.layout.report_id, state.layout.x_bits, state.layout.x_offset,
+          state.layout.y_bits, state.layout.y_offset);
+  return;
+
+err_destroy:
+  maccel_bpf__destroy(skel);
+}
+
+static void detach(struct attached_device *dev) {
+  bpf_link__destroy(dev->link);
+  bpf_map__delete_elem(dev->skel->maps.maccel_devices, &dev->hid_id,
+                       sizeof(dev->hid_id), 0);
+  // The maps live on while another instance uses them
+  maccel_bpf__destroy(dev->skel);
+  dev->skel = NULL;
+  fprintf(stderr, "detached from %s\n", dev->name);
+}
+
+static void scan_devices(void) {
+  char path[300];
+  struct stat st;
+  for (int i = 0; i < MAX_DEVICES; i++) {
+    if (devices[i].skel == NULL) {
+      continue;
+    }
+    int len =
+        snprintf(path, sizeof(path), HID_DEVICES_DIR "/%s", devices[i].name);
+    if (len < (int)sizeof(path) && stat(path, &st) < 0) {
+      detach(&devices[i]); // unplugged
+    }
+  }
+
+  DIR *dir = opendir(HID_DEVICES_DIR);
+  if (dir == NULL) {
+    return;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    int attached = 0;
+    for (int i = 0; i < MAX_DEVICES && !attached; i++) {
+      attached = devices[i].skel != NULL &&
+                 strcmp(devices[i].name, entry->d_name) == 0;
+    }
+    if (!attached) {
+      attach(entry->d_name);
+    }
+  }
+  closedir(dir);
+}
+
+/*
+ * The CLI stores the engines' parameters as decimals (see EngineStore), so
+ * they convert to our 16.16 whatever the width of the CLI's build.
+ */
+static fpt read_param(const char *name, fpt default_value) {
+  char path[128], buf[32];
+  snprintf(path, sizeof(path), PARAMS_DIR "/%s", name);
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    return default_value;
+  }
+  char *line = fgets(buf, sizeof(buf), file);
+  fclose(file);
+  if (line == NULL) {
+    return default_value;
+  }
+  char *end;
+  double value = strtod(line, &end);
+  if (end == line) {
+    return default_value;
+  }
+  return fpt_rconst(value);
+}
+
+/* With the defaults of driver/params.h */
+static struct accel_args read_params(void) {
+  struct accel_args args = {0};
+
+  args.sens_mult = read_param("SENS_MULT", fpt_rconst(1));
+  args.yx_ratio = read_param("YX_RATIO", fpt_rconst(1));
+  args.input_dpi = read_param("INPUT_DPI", fpt_rconst(1000));
+  args.angle_rotation_deg = read_param("ANGLE_ROTATION", 0);
+
+  char path[128], buf[8];
+  snprintf(path, sizeof(path), PARAMS_DIR "/MODE");
+  FILE *file = fopen(path, "r");
+  args.tag = linear;
+  if (file != NULL) {
+    if (fgets(buf, sizeof(buf), file) != NULL) {
+      args.tag = atoi(buf);
+    }
+    fclose(file);
+  }
+
+  switch (args.tag) {
+  case synchronous:
+    args.args.synchronous.gamma = read_param("GAMMA", fpt_rconst(1));
+    args.args.synchronous.smooth = read_param("SMOOTH", fpt_rconst(0.5));
+    args.args.synchronous.motivity = read_param("MOTIVITY", fpt_rconst(1.5));
+    args.args.synchronous.sync_speed = read_param("SYNC_SPEED", fpt_rconst(5));
+    break;
+  case natural:
+    args.args.natural.decay_rate = read_param("DECAY_RATE", fpt_rconst(0.1));
+    args.args.natural.offset = read_param("OFFSET", 0);
+    args.args.natural.limit = read_param("LIMIT", fpt_rconst(1.5));
+    break;
+  case linear:
+    args.args.linear.accel = read_param("ACCEL", 0);
+    args.args.linear.offset = read_param("OFFSET", 0);
+    args.args.linear.output_cap = read_param("OUTPUT_CAP", 0);
+    break;
+  case no_accel:
+  default:
+    break;
+  }
+
+  return args;
+}
+
+int main(void) {
+  struct stat st;
+  if (stat("/sys/module/maccel", &st) == 0) {
+    fprintf(stderr, "the maccel module is loaded: unload it first, "
+                    "or the mice would be accelerated twice\n");
+    return 1;
+  }
+
+  params = read_params();
+
+  for (;;) {
+    // Attaching to a mouse sets its parameters when it creates the maps
+    scan_devices();
+
+    usleep(500000);
+
+    struct accel_args args = read_params();
+    if (memcmp(&args, &params, sizeof(args)) != 0) {
+      params = args;
+      unsigned int zero = 0;
+      if (params_fd >= 0) {
+        bpf_map_update_elem(params_fd, &zero, &params, BPF_ANY);
+      }
+    }
+  }
+}
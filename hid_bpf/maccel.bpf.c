@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "vmlinux.h"
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_tracing.h>
+
+#include "maccel_hid.h"
+
+/*
+ * The acceleration as a HID-BPF program: it rewrites the X and Y of a
+ * mouse's input reports, with the driver's own `__f_accelerate`, before the
+ * HID core parses them into input events. So there's no input_handler and
+ * none of its version-specific workarounds: a rotated frame's missing axis
+ * is simply a field of the report that gets written.
+ *
+ * The loader (loader.c) attaches this to every mouse, tells us where its X
+ * and Y are through `maccel_devices`, and keeps `maccel_params` in sync with
+ * the parameters set by the CLI.
+ */
+
+extern __u8 *hid_bpf_get_data(struct hid_bpf_ctx *ctx, unsigned int offset,
+                              const size_t __sz) __ksym;
+
+struct {
+  __uint(type, BPF_MAP_TYPE_ARRAY);
+  __uint(max_entries, 1);
+  __type(key, __u32);
+  __type(value, struct accel_args);
+} maccel_params SEC(".maps");
+
+struct {
+  __uint(type, BPF_MAP_TYPE_HASH);
+  __uint(max_entries, 16);
+  __type(key, __u32);
+  __type(value, struct device_state);
+} maccel_devices SEC(".maps");
+
+static const int UNITS_PER_MS = 1000; // 1 thousand microseconds
+
+/*
+ * A field of up to 32 bits, at any bit offset, spans at most 5 bytes: we
+ * move those as one little-endian word, rather than bit by bit, so that a
+ * field costs the verifier a handful of instructions instead of a loop of
+ * 32 branches. The bytes past the end of the report are left out.
+ */
+#define FIELD_BYTES 5
+
+static __u64 load_field_bytes(const __u8 *data, __u32 byte) {
+  __u64 word = 0;
+
+  for (int i = 0; i < FIELD_BYTES; i++) {
+    if (byte + i < MACCEL_HID_REPORT_MAX) {
+      word |= (__u64)data[byte + i] << (i * 8);
+    }
+  }
+  return word;
+}
+
+static void store_field_bytes(__u8 *data, __u32 byte, __u64 word) {
+  for (int i = 0; i < FIELD_BYTES; i++) {
+    if (byte + i < MACCEL_HID_REPORT_MAX) {
+      data[byte + i] = word >> (i * 8);
+    }
+  }
+}
+
+static __u64 field_mask(__u8 bits) {
+  return bits >= 32 ? 0xffffffffull : (1ull << bits) - 1;
+}
+
+static int read_field(const __u8 *data, __u16 offset, __u8 bits) {
+  if (bits == 0) {
+    return 0;
+  }
+
+  __u32 value =
+      (load_field_bytes(data, offset / 8) >> (offset % 8)) & field_mask(bits);
+
+  // Sign extend
+  if (bits < 32 && (value >> (bits - 1)) & 1) {
+    value |= ~0u << bits;
+  }
+  return value;
+}
+
+/* Saturates what doesn't fit in the field, e.g. beyond ±127 for 8 bits */
+static void write_field(__u8 *data, __u16 offset, __u8 bits, int value) {
+  if (bits == 0) {
+    return;
+  }
+  if (bits < 32) {
+    int max = (1 << (bits - 1)) - 1;
+    value = value > max ? max : value < -max - 1 ? -max - 1 : value;
+  }
+
+  __u64 mask = field_mask(bits) << (offset % 8);
+  __u64 word = load_field_bytes(data, offset / 8) & ~mask;
+  word |= ((__u64)(__u32)value << (offset % 8)) & mask;
+  store_field_bytes(data, offset / 8, word);
+}
+
+SEC("struct_ops/hid_device_event")
+int BPF_PROG(maccel_device_event, struct hid_bpf_ctx *hctx,
+             enum hid_report_type type, __u64 source) {
+  if (type != HID_INPUT_REPORT) {
+    return 0;
+  }
+
+  __u32 id = hctx->hid->id;
+  struct device_state *dev = bpf_map_lookup_elem(&maccel_devices, &id);
+  __u32 zero = 0;
+  struct accel_args *args = bpf_map_lookup_elem(&maccel_params, &zero);
+  if (dev == NULL || args == NULL) {
+    return 0;
+  }
+
+  __u8 *data = hid_bpf_get_data(hctx, 0, MACCEL_HID_REPORT_MAX);
+  if (data == NULL) {
+    return 0;
+  }
+
+  struct report_layout layout = dev->layout;
+  if (layout.report_id && data[0] != layout.report_id) {
+    return 0;
+  }
+
+  int x = read_field(data, layout.x_offset, layout.x_bits);
+  int y = read_field(data, layout.y_offset, layout.y_bits);
+  if (!x && !y) {
+    return 0;
+  }
+
+  __u64 now = bpf_ktime_get_ns();
+  fpt millisecond =
+      frame_interval_ms((now - dev->last_time_ns) / 1000, UNITS_PER_MS);
+  dev->last_time_ns = now;
+
+  __f_accelerate(&x, &y, millisecond, *args, &dev->state);
+
+  write_field(data, layout.x_offset, layout.x_bits, x);
+  write_field(data, layout.y_offset, layout.y_bits, y);
+
+  return 0; // the report keeps its size
+}
+
+SEC(".struct_ops.link")
+struct hid_bpf_ops maccel = {
+    .hid_device_event = (void *)maccel_device_event,
+};
+
+char _license[] SEC("license") = "GPL";
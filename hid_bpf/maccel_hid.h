@@ -0,0 +1,33 @@
+#ifndef _MACCEL_HID_H_
+#define _MACCEL_HID_H_
+
+/*
+ * What the HID-BPF program (maccel.bpf.c) and its loader (loader.c) share
+ * through the BPF maps. Both are built with FIXEDPT_BITS=32: there's no
+ * 128 bits arithmetic in BPF.
+ */
+
+#include "../driver/accel.h"
+
+/* hid_bpf_get_data() needs a constant size, the reports we handle fit */
+#define MACCEL_HID_REPORT_MAX 64
+
+/* Where the relative X and Y are in a mouse's input report */
+struct report_layout {
+  /* The report's id, 0 if the device doesn't number its reports */
+  unsigned char report_id;
+  unsigned char x_bits;
+  unsigned char y_bits;
+  /* In bits, from the start of the report (including its id) */
+  unsigned short x_offset;
+  unsigned short y_offset;
+};
+
+/* A mouse's entry in the `maccel_devices` map, keyed by its HID id */
+struct device_state {
+  struct report_layout layout;
+  struct accel_state state;
+  unsigned long long last_time_ns;
+};
+
+#endif // !_MACCEL_HID_H_
@@ -0,0 +1,51 @@
+//! What a frame of the TUI costs: a tick, where the graph catches up with
+//! the parameters, then a render of the whole screen. Against a fake sysfs
+//! tree, in a headless terminal.
+//!
+//! Run with `make bench_cli` from the repository's root, to compare against
+//! the saved baseline (see bench/criterion.sh).
+
+use criterion::{BenchmarkId, Criterion, criterion_group, criterion_main};
+use maccel_core::{ALL_MODES, Param, persist::FakeSysfs};
+use maccel_tui::headless::HeadlessTui;
+
+/// A common size for a terminal window
+const WIDTH: u16 = 160;
+const HEIGHT: u16 = 48;
+
+fn frames(c: &mut Criterion) {
+    let _sysfs = FakeSysfs::install().expect("failed to set up a fake sysfs tree");
+    let mut tui = HeadlessTui::new(WIDTH, HEIGHT).expect("failed to start the TUI");
+
+    let mut group = c.benchmark_group("frame");
+
+    for &mode in ALL_MODES {
+        let mode_name = format!("{mode:?}");
+        tui.show(mode);
+        tui.tick();
+
+        // Nothing changed: what every tick costs, and every redraw
+        group.bench_function(BenchmarkId::new("tick", &mode_name), |b| {
+            b.iter(|| tui.tick())
+        });
+        group.bench_function(BenchmarkId::new("draw", &mode_name), |b| {
+            b.iter(|| tui.draw().unwrap())
+        });
+
+        // A parameter was just edited, so the curve is recomputed
+        let mut sens_mult = 1.0;
+        group.bench_function(BenchmarkId::new("edit_tick_draw", &mode_name), |b| {
+            b.iter(|| {
+                sens_mult = if sens_mult == 1.0 { 1.25 } else { 1.0 };
+                tui.set_param(Param::SensMult, sens_mult).unwrap();
+                tui.tick();
+                tui.draw().unwrap();
+            })
+        });
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, frames);
+criterion_main!(benches);
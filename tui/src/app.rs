@@ -8,13 +8,12 @@ use maccel_core::ALL_SYNCHRONOUS_PARAMS;
 use maccel_core::Param;
 use maccel_core::get_param_value_from_ctx;
 use maccel_core::persist::ParamStore;
-use maccel_core::persist::SysFsStore;
 use maccel_core::{ALL_PARAMS, AccelMode, ContextRef, TuiContext};
 use ratatui::Terminal;
 use ratatui::backend::Backend;
 use ratatui::crossterm::event::{DisableMouseCapture, EnableMouseCapture, KeyCode, KeyEventKind};
-use std::{io, time::Instant};
-use std::{panic, time::Duration};
+use std::io;
+use std::panic;
 use tracing::debug;
 
 use crate::action::{Action, Actions};
@@ -25,19 +24,19 @@ use crate::param_input::ParameterInput;
 use crate::screen::Screen;
 use crate::utils::CyclingIdx;
 
-pub struct App {
-    context: ContextRef<SysFsStore>,
-    screens: Vec<Screen<SysFsStore>>,
+pub struct App<PS: ParamStore> {
+    context: ContextRef<PS>,
+    screens: Vec<Screen<PS>>,
     screen_idx: CyclingIdx,
     pub(crate) is_running: bool,
-
-    last_tick_at: Instant,
+    /// Whether a terminal event came in since the last draw
+    dirty: bool,
 }
 
-pub fn collect_inputs_for_params(
+pub fn collect_inputs_for_params<PS: ParamStore>(
     params: &[Param],
-    context: ContextRef<SysFsStore>,
-) -> Vec<ParameterInput<SysFsStore>> {
+    context: ContextRef<PS>,
+) -> Vec<ParameterInput<PS>> {
     ALL_COMMON_PARAMS
         .iter()
         .chain(params)
@@ -46,10 +45,11 @@ pub fn collect_inputs_for_params(
         .collect()
 }
 
-impl App {
-    pub fn new() -> Self {
+impl<PS: ParamStore + 'static> App<PS> {
+    pub fn new(parameter_store: PS) -> Self {
         let context = ContextRef::new(
-            TuiContext::init(SysFsStore, ALL_PARAMS).expect("Failed to initialize the Tui Context"),
+            TuiContext::init(parameter_store, ALL_PARAMS)
+                .expect("Failed to initialize the Tui Context"),
         );
 
         Self {
@@ -116,25 +116,15 @@ impl App {
             ),
             context,
             is_running: true,
-            last_tick_at: Instant::now(),
+            dirty: true,
         }
     }
 
-    pub(crate) fn tick(&mut self) -> bool {
-        #[cfg(not(debug_assertions))]
-        let tick_rate = 16;
-
-        #[cfg(debug_assertions)]
-        let tick_rate = 100;
-
-        let do_tick = self.last_tick_at.elapsed() >= Duration::from_millis(tick_rate);
-        do_tick.then(|| {
-            self.last_tick_at = Instant::now();
-        });
-        do_tick
+    pub(crate) fn needs_redraw(&self) -> bool {
+        self.dirty || self.current_screen().needs_redraw()
     }
 
-    fn current_screen_mut(&mut self) -> &mut Screen<SysFsStore> {
+    fn current_screen_mut(&mut self) -> &mut Screen<PS> {
         let screen_idx = self.screen_idx.current();
         self.screens.get_mut(screen_idx).unwrap_or_else(|| {
             panic!(
@@ -144,7 +134,7 @@ impl App {
         })
     }
 
-    fn current_screen(&self) -> &Screen<SysFsStore> {
+    fn current_screen(&self) -> &Screen<PS> {
         let screen_idx = self.screen_idx.current();
         self.screens.get(screen_idx).unwrap_or_else(|| {
             panic!(
@@ -157,11 +147,28 @@ impl App {
     fn can_switch_screens(&self) -> bool {
         self.screens.len() > 1 && !self.current_screen().is_in_editing_mode()
     }
+
+    /// Switch to the screen of `mode`, as the arrow keys do
+    #[cfg(feature = "bench")]
+    pub(crate) fn show_screen(&mut self, mode: AccelMode) {
+        self.screen_idx = CyclingIdx::new_starting_at(self.screens.len(), mode.ordinal() as usize);
+        self.update(&mut vec![Action::SetMode(mode)]);
+    }
+
+    #[cfg(feature = "bench")]
+    pub(crate) fn set_param(&mut self, param: Param, value: f64) -> anyhow::Result<()> {
+        self.context.get_mut().update_param_value(param, value)
+    }
 }
 
-impl App {
+impl<PS: ParamStore + 'static> App<PS> {
     pub(crate) fn handle_event(&mut self, event: &Event, actions: &mut Actions) {
         debug!("received event: {:?}", event);
+        if let Event::InputSpeed = event {
+            // The graph knows whether that's worth a redraw
+            return;
+        }
+        self.dirty = true;
         if let Event::Key(crossterm::event::KeyEvent {
             kind: KeyEventKind::Press,
             code,
@@ -201,9 +208,9 @@ impl App {
 
         for action in actions.drain(..) {
             if let Action::SetMode(accel_mode) = action {
-                self.context.get_mut().current_mode = accel_mode;
-                SysFsStore
-                    .set_current_accel_mode(accel_mode)
+                self.context
+                    .get_mut()
+                    .update_current_mode(accel_mode)
                     .expect("Failed to set accel mode in TUI");
                 self.context.get_mut().reset_current_parameters();
             }
@@ -259,8 +266,9 @@ impl<B: Backend> Tui<B> {
     ///
     /// [`Draw`]: ratatui::Terminal::draw
     /// [`rendering`]: crate::ui::render
-    pub fn draw(&mut self, app: &mut App) -> anyhow::Result<()> {
+    pub fn draw<PS: ParamStore + 'static>(&mut self, app: &mut App<PS>) -> anyhow::Result<()> {
         self.terminal.draw(|frame| app.draw(frame, frame.area()))?;
+        app.dirty = false;
         Ok(())
     }
 
@@ -13,6 +13,7 @@ pub trait TuiComponent {
         match event {
             Event::Key(key_event) => self.handle_key_event(key_event, actions),
             Event::Mouse(mouse_event) => self.handle_mouse_event(mouse_event, actions),
+            Event::Resize | Event::InputSpeed => {}
         }
     }
     fn handle_key_event(&mut self, event: &KeyEvent, actions: &mut Actions);
@@ -21,6 +22,12 @@ pub trait TuiComponent {
     /// Stuff to do on any action derived from an event
     fn update(&mut self, action: &Action);
 
+    /// Whether the component changed since it was last drawn, other than
+    /// through terminal events (which always cause a redraw)
+    fn needs_redraw(&self) -> bool {
+        false
+    }
+
     fn draw(&self, frame: &mut Frame, area: Rect);
 }
 
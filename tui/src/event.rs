@@ -1,4 +1,4 @@
-use std::sync::mpsc::TryRecvError;
+use std::sync::mpsc::Sender;
 
 use crossterm::event::Event as CrosstermEvent;
 use crossterm::event::MouseEventKind;
@@ -7,46 +7,50 @@ use crossterm::event::MouseEventKind;
 pub enum Event {
     Key(crossterm::event::KeyEvent),
     Mouse(crossterm::event::MouseEvent),
+    Resize,
+    /// The mouse moved at a new speed, see `inputspeed::read_input_speed`
+    InputSpeed,
 }
 
 #[derive(Debug)]
 pub struct EventHandler {
+    tx: Sender<Event>,
     rx: std::sync::mpsc::Receiver<Event>,
 }
 
 impl EventHandler {
     pub fn new() -> Self {
-        let tick_rate = std::time::Duration::from_millis(33);
         let (tx, rx) = std::sync::mpsc::channel();
+        let terminal_tx = tx.clone();
         std::thread::spawn(move || -> anyhow::Result<()> {
             loop {
-                if crossterm::event::poll(tick_rate)? {
-                    match crossterm::event::read()? {
-                        CrosstermEvent::Key(e) => tx.send(Event::Key(e)),
-                        CrosstermEvent::Mouse(e) => {
-                            if e.kind == MouseEventKind::Moved {
-                                // These are annoying because they get buffered
-                                // while you move your mouse a bunch and delay
-                                // other events, e.g 'q' quitting could much longer than it should.
-                                continue;
-                            }
-                            tx.send(Event::Mouse(e))
+                match crossterm::event::read()? {
+                    CrosstermEvent::Key(e) => terminal_tx.send(Event::Key(e)),
+                    CrosstermEvent::Mouse(e) => {
+                        if e.kind == MouseEventKind::Moved {
+                            // These are annoying because they get buffered
+                            // while you move your mouse a bunch and delay
+                            // other events, e.g 'q' quitting could much longer than it should.
+                            continue;
                         }
-                        CrosstermEvent::Resize(_col, _row) => continue,
-                        event => unimplemented!("event {event:?}"),
-                    }?
-                }
+                        terminal_tx.send(Event::Mouse(e))
+                    }
+                    CrosstermEvent::Resize(_col, _row) => terminal_tx.send(Event::Resize),
+                    event => unimplemented!("event {event:?}"),
+                }?
             }
         });
 
-        EventHandler { rx }
+        EventHandler { tx, rx }
     }
 
-    pub fn next(&self) -> anyhow::Result<Option<Event>> {
-        Ok(match self.rx.try_recv() {
-            Ok(e) => Some(e),
-            Err(TryRecvError::Empty) => None,
-            Err(err) => return Err(err.into()),
-        })
+    /// For other threads to send events, e.g. the input speed reader
+    pub fn sender(&self) -> Sender<Event> {
+        self.tx.clone()
+    }
+
+    /// Wait for the next event
+    pub fn next(&self) -> anyhow::Result<Event> {
+        Ok(self.rx.recv()?)
     }
 }
@@ -1,6 +1,9 @@
-use std::fmt::Debug;
+use std::{cell::Cell, fmt::Debug};
 
-use maccel_core::{ContextRef, SensXY, get_param_value_from_ctx, persist::ParamStore, sensitivity};
+use maccel_core::{
+    AccelMode, AllParamArgs, ContextRef, SensitivityFn, get_param_value_from_ctx,
+    persist::ParamStore,
+};
 
 use crate::{action, component::TuiComponent};
 
@@ -8,6 +11,16 @@ use crossterm::event::KeyEvent;
 use ratatui::{prelude::*, widgets::*};
 use tracing::debug;
 
+/// Input speeds shown on the graph, in counts/ms
+const MAX_SPEED: f64 = 128.0;
+/// Evenly spaced intervals that the curve is first sampled on
+const COARSE_INTERVALS: usize = 32;
+/// How many times an interval can be bisected where the curve bends
+const MAX_REFINEMENTS: usize = 6;
+/// How far (in sensitivity) the curve can stray from a straight line
+/// between two samples before the interval gets bisected
+const BEND_TOLERANCE: f64 = 0.002;
+
 #[derive(Debug, Default)]
 struct LastMouseMove {
     in_speed: f64,
@@ -25,6 +38,13 @@ impl LastMouseMove {
     }
 }
 
+/// What the curve is computed from, so that it's only recomputed when it changes
+#[derive(Debug, PartialEq)]
+struct CurveKey {
+    mode: AccelMode,
+    params: AllParamArgs,
+}
+
 pub type GetNewYAxisBounds<PS> = dyn FnMut(ContextRef<PS>) -> [f64; 2];
 
 pub struct SensitivityGraph<PS: ParamStore> {
@@ -32,6 +52,9 @@ pub struct SensitivityGraph<PS: ParamStore> {
     pub y_bounds: [f64; 2],
     data: Vec<(f64, f64)>,
     data_alt: Vec<(f64, f64)>,
+    curve: Option<(CurveKey, SensitivityFn)>,
+    /// Whether the curve or the last mouse move changed since the last draw
+    dirty: Cell<bool>,
     title: &'static str,
     data_name: String,
     data_alt_name: String,
@@ -47,6 +70,8 @@ impl<PS: ParamStore> SensitivityGraph<PS> {
             y_bounds: [0.0, 0.0],
             data: vec![],
             data_alt: vec![],
+            curve: None,
+            dirty: Cell::new(true),
             title: "Sensitivity Graph (Ratio = Speed_out / Speed_in)",
             data_name: "🠠🠢 Sens".to_string(),
             data_alt_name: "🠡🠣 Sens".to_string(),
@@ -67,14 +92,30 @@ impl<PS: ParamStore> SensitivityGraph<PS> {
         self
     }
 
-    fn update_data(&mut self) {
+    /// Recompute the curve if the mode or any parameter changed,
+    /// returns whether it did.
+    fn update_curve(&mut self) -> bool {
+        let key = CurveKey {
+            mode: self.context.get().current_mode,
+            params: self.context.get().params_snapshot(),
+        };
+        if self.curve.as_ref().is_some_and(|(k, _)| *k == key) {
+            return false;
+        }
+
+        debug!("recomputing the sensitivity curve for {:?}", key.mode);
+        let sens_fn = SensitivityFn::new(key.mode, &key.params);
+        self.update_data(&sens_fn);
+        self.y_bounds = (self.on_y_axis_update_fn)(self.context.clone());
+        self.curve = Some((key, sens_fn));
+        true
+    }
+
+    fn update_data(&mut self, sens_fn: &SensitivityFn) {
         self.data.clear();
         self.data_alt.clear();
 
-        let params = self.context.get().params_snapshot();
-        for x in (0..128).map(|x| (x as f64) * 1.0 /* step size */) {
-            let (sens_x, sens_y) =
-                maccel_core::sensitivity(x, self.context.get().current_mode, &params);
+        for (x, sens_x, sens_y) in sample_curve(sens_fn, MAX_SPEED) {
             self.data.push((x, sens_x));
             if sens_x != sens_y {
                 self.data_alt.push((x, sens_y));
@@ -82,23 +123,23 @@ impl<PS: ParamStore> SensitivityGraph<PS> {
         }
     }
 
-    fn read_input_speed_and_resolved_sens(&self) -> (f64, SensXY) {
-        let input_speed = maccel_core::inputspeed::read_input_speed();
-        let params = self.context.get().params_snapshot();
-        debug!("last mouse move read at {} counts/ms", input_speed);
-        (
-            input_speed,
-            sensitivity(input_speed, self.context.get().current_mode, &params),
-        )
-    }
+    fn update_last_move(&mut self, curve_changed: bool) -> bool {
+        let in_speed = maccel_core::inputspeed::read_input_speed();
+        if !curve_changed && in_speed == self.last_mouse_move.in_speed {
+            return false;
+        }
+        debug!("last mouse move read at {} counts/ms", in_speed);
 
-    fn update_last_move(&mut self) {
-        let (in_speed, out_sens) = self.read_input_speed_and_resolved_sens();
+        let Some((_, sens_fn)) = &self.curve else {
+            return false;
+        };
+        let (out_sens_x, out_sens_y) = sens_fn.eval(in_speed);
         self.last_mouse_move = LastMouseMove {
             in_speed,
-            out_sens_x: out_sens.0,
-            out_sens_y: out_sens.1,
+            out_sens_x,
+            out_sens_y,
         };
+        true
     }
 
     fn formatted_current_point(&self, x: f64, y: f64) -> String {
@@ -106,6 +147,88 @@ impl<PS: ParamStore> SensitivityGraph<PS> {
     }
 }
 
+/// Sample the curve over `[0, max_x]` as `(speed, sens_x, sens_y)` points.
+///
+/// Start from evenly spaced intervals, and keep bisecting those where the
+/// curve strays from a straight line, so that knees (e.g. at the offset or
+/// the sync speed) get many more points than the flat stretches.
+fn sample_curve(sens_fn: &SensitivityFn, max_x: f64) -> Vec<(f64, f64, f64)> {
+    let eval = |speeds: &[f64]| {
+        let mut sens_x = vec![0.0; speeds.len()];
+        let mut sens_y = vec![0.0; speeds.len()];
+        sens_fn.eval_batch(speeds, &mut sens_x, &mut sens_y);
+        speeds
+            .iter()
+            .zip(sens_x)
+            .zip(sens_y)
+            .map(|((&x, sens_x), sens_y)| (x, sens_x, sens_y))
+            .collect::<Vec<_>>()
+    };
+
+    let step = max_x / COARSE_INTERVALS as f64;
+    let speeds: Vec<f64> = (0..=COARSE_INTERVALS).map(|i| i as f64 * step).collect();
+    let mut points = eval(&speeds);
+    let mut to_refine = vec![true; points.len() - 1];
+
+    for _ in 0..MAX_REFINEMENTS {
+        let midpoints: Vec<f64> = points
+            .windows(2)
+            .zip(&to_refine)
+            .filter(|(_, refine)| **refine)
+            .map(|(pair, _)| (pair[0].0 + pair[1].0) / 2.0)
+            .collect();
+        if midpoints.is_empty() {
+            break;
+        }
+        let mut midpoints = eval(&midpoints).into_iter();
+        let midpoints: Vec<_> = to_refine
+            .iter()
+            .map(|&refine| refine.then(|| midpoints.next().expect("a midpoint per interval")))
+            .collect();
+
+        let bent: Vec<bool> = points
+            .windows(2)
+            .zip(&midpoints)
+            .map(|(pair, mid)| {
+                let (a, b) = (pair[0], pair[1]);
+                mid.is_some_and(|mid| {
+                    (mid.1 - (a.1 + b.1) / 2.0).abs() > BEND_TOLERANCE
+                        || (mid.2 - (a.2 + b.2) / 2.0).abs() > BEND_TOLERANCE
+                })
+            })
+            .collect();
+        // An inflection point right in the middle of an interval looks straight
+        // from its midpoint, but its neighbours bend in opposite directions.
+        let bends = (0..bent.len()).map(|i| {
+            bent[i]
+                || (midpoints[i].is_some()
+                    && i > 0
+                    && i + 1 < bent.len()
+                    && bent[i - 1]
+                    && bent[i + 1])
+        });
+
+        let mut refined = Vec::with_capacity(points.len() * 2);
+        let mut refined_to_refine = Vec::with_capacity(to_refine.len() * 2);
+        for ((&a, mid), bends) in points.iter().zip(&midpoints).zip(bends) {
+            refined.push(a);
+            match mid {
+                Some(mid) if bends => {
+                    refined.push(*mid);
+                    refined_to_refine.extend([true, true]);
+                }
+                _ => refined_to_refine.push(false),
+            }
+        }
+        refined.extend(points.last());
+
+        points = refined;
+        to_refine = refined_to_refine;
+    }
+
+    points
+}
+
 impl<PS: ParamStore> TuiComponent for SensitivityGraph<PS> {
     fn handle_key_event(&mut self, _event: &KeyEvent, _actions: &mut action::Actions) {}
 
@@ -118,15 +241,22 @@ impl<PS: ParamStore> TuiComponent for SensitivityGraph<PS> {
 
     fn update(&mut self, action: &action::Action) {
         if let action::Action::Tick = action {
-            debug!("updating graph on tick");
-            self.update_last_move();
-            self.update_data();
-            self.y_bounds = (self.on_y_axis_update_fn)(self.context.clone());
+            let curve_changed = self.update_curve();
+            let moved = self.update_last_move(curve_changed);
+            if curve_changed || moved {
+                self.dirty.set(true);
+            }
         }
     }
 
+    fn needs_redraw(&self) -> bool {
+        self.dirty.get()
+    }
+
     fn draw(&self, frame: &mut ratatui::Frame, area: ratatui::prelude::Rect) {
-        let (bounds, labels) = bounds_and_labels([0.0, 128.0], 16);
+        self.dirty.set(false);
+
+        let (bounds, labels) = bounds_and_labels([0.0, MAX_SPEED], 16);
         let x_axis = Axis::default()
             .title("Speed_in".magenta())
             .style(Style::default().white())
@@ -212,3 +342,80 @@ fn bounds_and_labels(bounds: [f64; 2], div: usize) -> ([f64; 2], Vec<Span<'stati
 
     (bounds, labels)
 }
+
+#[cfg(test)]
+mod test {
+    use maccel_core::{AccelMode, AllParamArgs, SensitivityFn, fixedptc::Fpt};
+
+    use super::{BEND_TOLERANCE, COARSE_INTERVALS, MAX_REFINEMENTS, MAX_SPEED, sample_curve};
+
+    fn params(accel: f64, offset: f64, output_cap: f64) -> AllParamArgs {
+        AllParamArgs {
+            sens_mult: Fpt::from(1.0),
+            yx_ratio: Fpt::from(1.0),
+            input_dpi: Fpt::from(1000.0),
+            angle_rotation: Fpt::from(0.0),
+            accel: Fpt::from(accel),
+            offset_linear: Fpt::from(offset),
+            output_cap: Fpt::from(output_cap),
+            decay_rate: Fpt::from(0.1),
+            offset_natural: Fpt::from(0.0),
+            limit: Fpt::from(1.5),
+            gamma: Fpt::from(1.0),
+            smooth: Fpt::from(0.5),
+            motivity: Fpt::from(1.5),
+            sync_speed: Fpt::from(5.0),
+        }
+    }
+
+    const MIN_INTERVAL: f64 = MAX_SPEED / COARSE_INTERVALS as f64 / (1 << MAX_REFINEMENTS) as f64;
+
+    #[test]
+    fn samples_a_flat_curve_only_on_the_coarse_intervals() {
+        let sens_fn = SensitivityFn::new(AccelMode::NoAccel, &params(0.0, 0.0, 0.0));
+
+        let points = sample_curve(&sens_fn, MAX_SPEED);
+
+        assert_eq!(points.len(), COARSE_INTERVALS + 1);
+        assert_eq!(points.first().unwrap().0, 0.0);
+        assert_eq!(points.last().unwrap().0, MAX_SPEED);
+    }
+
+    #[test]
+    fn keeps_a_sharp_bend_within_the_tolerance() {
+        // A sharp knee where it reaches the cap, off the grid (at ~18.06)
+        let sens_fn = SensitivityFn::new(AccelMode::Linear, &params(0.3, 10.3, 2.0));
+
+        let points = sample_curve(&sens_fn, MAX_SPEED);
+
+        assert!(points.len() > COARSE_INTERVALS + 1, "the bends got refined");
+        assert!(points.len() <= COARSE_INTERVALS * (1 << MAX_REFINEMENTS) + 1);
+        assert!(points.windows(2).all(|pair| pair[0].0 < pair[1].0));
+
+        // Every interval is either straight, or as narrow as it gets
+        for pair in points.windows(2) {
+            let (a, b) = (pair[0], pair[1]);
+            let width = b.0 - a.0;
+            let (mid_x, mid_y) = sens_fn.eval((a.0 + b.0) / 2.0);
+            let stray = f64::max(
+                (mid_x - (a.1 + b.1) / 2.0).abs(),
+                (mid_y - (a.2 + b.2) / 2.0).abs(),
+            );
+            assert!(
+                stray <= BEND_TOLERANCE || width <= MIN_INTERVAL * 1.0001,
+                "[{}, {}] strays by {stray}",
+                a.0,
+                b.0
+            );
+        }
+
+        let capped = points
+            .iter()
+            .position(|p| p.1 >= 2.0)
+            .expect("the curve reaches the cap");
+        assert!(
+            points[capped].0 - points[capped - 1].0 <= MIN_INTERVAL * 1.0001,
+            "the knee is bracketed as tightly as it gets"
+        );
+    }
+}
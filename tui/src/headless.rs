@@ -0,0 +1,44 @@
+//! The TUI without a terminal, for the benches: driven tick by tick, with
+//! its frames rendered into an in-memory buffer.
+
+use maccel_core::{AccelMode, Param, persist::SysFsStore};
+use ratatui::{Terminal, backend::TestBackend};
+
+use crate::{action::Action, app::App};
+
+pub struct HeadlessTui {
+    app: App<SysFsStore>,
+    terminal: Terminal<TestBackend>,
+}
+
+impl HeadlessTui {
+    /// The TUI as `maccel tui` starts it, on a `width` by `height` terminal
+    pub fn new(width: u16, height: u16) -> anyhow::Result<Self> {
+        Ok(Self {
+            app: App::new(SysFsStore),
+            terminal: Terminal::new(TestBackend::new(width, height))?,
+        })
+    }
+
+    pub fn show(&mut self, mode: AccelMode) {
+        self.app.show_screen(mode);
+    }
+
+    /// What follows every event: the graph catches up with the parameters
+    /// and the last mouse move
+    pub fn tick(&mut self) {
+        self.app.update(&mut vec![Action::Tick]);
+    }
+
+    /// Render the current screen, whether or not it changed
+    pub fn draw(&mut self) -> anyhow::Result<()> {
+        self.terminal
+            .draw(|frame| self.app.draw(frame, frame.area()))?;
+        Ok(())
+    }
+
+    /// Set a parameter as its input does, the next tick recomputes the curve
+    pub fn set_param(&mut self, param: Param, value: f64) -> anyhow::Result<()> {
+        self.app.set_param(param, value)
+    }
+}
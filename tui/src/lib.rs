@@ -1,6 +1,6 @@
-use maccel_core::inputspeed;
+use maccel_core::{inputspeed, persist::ParamStore};
 
-use event::EventHandler;
+use event::{Event, EventHandler};
 use ratatui::{Terminal, prelude::CrosstermBackend};
 
 mod event;
@@ -9,13 +9,17 @@ mod action;
 mod app;
 mod component;
 mod graph;
+#[cfg(feature = "bench")]
+pub mod headless;
 mod param_input;
 mod screen;
 mod utils;
 mod widgets;
 
-pub fn run_tui() -> anyhow::Result<()> {
-    let mut app = app::App::new();
+/// Edit the parameters in `parameter_store`: the module's, or the userspace
+/// engine's
+pub fn run_tui(parameter_store: impl ParamStore + 'static) -> anyhow::Result<()> {
+    let mut app = app::App::new(parameter_store);
 
     let backend = CrosstermBackend::new(std::io::stdout());
     let terminal = Terminal::new(backend)?;
@@ -24,17 +28,26 @@ pub fn run_tui() -> anyhow::Result<()> {
     let mut tui = app::Tui::new(terminal, events);
     tui.init()?;
 
-    let input_speed_thread_handle = inputspeed::setup_input_speed_reader();
+    let input_speed_events = tui.events.sender();
+    let input_speed_thread_handle = inputspeed::setup_input_speed_reader(move || {
+        // The TUI is exiting once no one receives them anymore
+        let _ = input_speed_events.send(Event::InputSpeed);
+    });
+
+    let mut actions = vec![action::Action::Tick];
+    app.update(&mut actions);
+    tui.draw(&mut app)?;
 
-    let mut actions = vec![];
     while app.is_running {
-        if let Some(event) = tui.events.next()? {
-            app.handle_event(&event, &mut actions);
-            app.update(&mut actions);
-        }
+        // Sleep until there's an event: from the terminal, or a new input speed
+        let event = tui.events.next()?;
+        app.handle_event(&event, &mut actions);
+
+        // Then the graph catches up with the parameters and the last mouse move
+        actions.push(action::Action::Tick);
+        app.update(&mut actions);
 
-        if app.tick() {
-            app.update(&mut vec![action::Action::Tick]);
+        if app.needs_redraw() {
             tui.draw(&mut app)?;
         }
     }
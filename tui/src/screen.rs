@@ -148,6 +148,10 @@ impl<PS: ParamStore + Debug> TuiComponent for Screen<PS> {
         self.preview_slot.update(action);
     }
 
+    fn needs_redraw(&self) -> bool {
+        self.preview_slot.needs_redraw()
+    }
+
     fn draw(&self, frame: &mut ratatui::Frame, area: Rect) {
         let root_layout = Layout::new(
             Direction::Vertical,